@@ -7,6 +7,28 @@
 #define BIGINT_H
 
 #include <iostream>
+#include <vector>
+#include <functional>
+#include <future>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <fstream>
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define BIGINT_COROUTINES
+#endif
+#endif
 
 namespace my {
     struct myExceptions : public std::exception {
@@ -24,9 +46,80 @@ namespace my {
     struct indexOutOfRange : public myExceptions {
         indexOutOfRange(const char* s): myExceptions(s) {}
     };
+    struct invalidFormat : public myExceptions {
+        invalidFormat(const char* s): myExceptions(s) {}
+    };
+    struct invalidArgument : public myExceptions {
+        invalidArgument(const char* s): myExceptions(s) {}
+    };
+    struct operationCancelled : public myExceptions {
+        operationCancelled(const char* s): myExceptions(s) {}
+    };
+
+    /* Cooperative cancellation for long computations. Copies share one state, so a token can be
+     * cancelled from any thread while a computation holding a copy checks it between steps.
+     * A deadline cancels the token once it has passed.
+     */
+    class CancellationToken {
+        private:
+        struct State {
+            std::atomic<bool> cancelled;
+            std::atomic<long long> deadline;    //steady_clock ticks, 0 for none
+            State(): cancelled(false), deadline(0) {}
+        };
+        std::shared_ptr<State> state;
+        public:
+        CancellationToken(): state(std::make_shared<State>()) {}
+        void cancel() {state->cancelled = true;}
+        void set_deadline(std::chrono::steady_clock::time_point t) {
+            long long ticks = t.time_since_epoch().count();
+            state->deadline = (ticks == 0)? 1 : ticks;
+        }
+        template<typename Rep, typename Period>
+        void cancel_after(std::chrono::duration<Rep, Period> d) {
+            set_deadline(std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(d));
+        }
+        bool cancelled() const {
+            if (state->cancelled)
+                return true;
+            long long d = state->deadline;
+            if (d != 0 && std::chrono::steady_clock::now().time_since_epoch().count() >= d)
+                state->cancelled = true;
+            return state->cancelled;
+        }
+        void throw_if_cancelled() const {
+            if (cancelled())
+                throw operationCancelled("Operation cancelled.");
+        }
+    };
+    //called with the fraction of the work done, from 0 to 1
+    typedef std::function<void(double)> ProgressCallback;
     
+    //Compile-time defaults for the algorithm crossovers, used when no tuning profile is loaded.
+    #ifndef BIGINT_KARATSUBA_THRESHOLD
+    #define BIGINT_KARATSUBA_THRESHOLD 48
+    #endif
+    #ifndef BIGINT_PARALLEL_PRODUCT_THRESHOLD
+    #define BIGINT_PARALLEL_PRODUCT_THRESHOLD 4096
+    #endif
+
+    /* Crossover points between algorithm tiers, in decimal digits.
+     * karatsuba        : multiply uses Karatsuba once both operands have this many digits.
+     * parallel_product : product(..., true) runs a product-tree node on its own thread once
+     *                    its operands have this many digits in total.
+     */
+    struct BigIntThresholds {
+        int karatsuba;
+        int parallel_product;
+        BigIntThresholds(): karatsuba(BIGINT_KARATSUBA_THRESHOLD),
+            parallel_product(BIGINT_PARALLEL_PRODUCT_THRESHOLD) {}
+    };
+
     long long pow2[62] = {0};  //look up table for powers of 2 from 2^1 to 2^62
-    long long lengths[19] = {0}; //look up table to find number lengths
+
+    class BigIntView;
+    class RnsInt;
 
     class BigInt {
         private:
@@ -67,17 +160,6 @@ namespace my {
             }
             return -1; //this never executes because n is bound to be within the range.
         }
-        int numLength(long long n) const {
-            if (!lengths[0]) { //this executes only once
-                lengths[0] = 10;
-                for (int i = 1; i < 18; ++i)
-                    lengths[i] = 10 * lengths[i-1];
-                lengths[18] = 9223372036854775807;  //LLONG_MAX
-            }
-            if (n < 10) return 1;
-            if (n == lengths[18]) return 19;
-            return lower_bound(lengths, n, 19) + 2;
-        }
         //used in all move operations
         void move(BigInt&& b) {
             delete [] arr;
@@ -144,7 +226,7 @@ namespace my {
                 carry = sum/10;
             }
             while (carry) {
-                sum = arr[i] + carry;
+                sum = (i < inUse? arr[i] : 0) + carry;
                 result.arr[i] = sum % 10;
                 carry = sum/10;
                 ++i;
@@ -178,7 +260,7 @@ namespace my {
                     borrow = 0;
                 res[i] = sub;
             }
-            if (res[i-1] == 0) --i;
+            while (i > 0 && res[i-1] == 0) --i;
             return i;
         }
         BigInt subtract(const BigInt& b, bool move = false) {
@@ -202,10 +284,173 @@ namespace my {
             if (move) this->move(std::forward<BigInt&&>(result));
             return result;
         }
+        /*------------------------------Algorithm thresholds-------------------------------*/
+        struct Tuning {
+            std::atomic<int> karatsuba;
+            std::atomic<int> parallelProduct;
+        };
+        //reads "name value" lines; unknown names and lines starting with # are skipped
+        static bool parseProfile(const char* path, BigIntThresholds& t) {
+            std::ifstream in(path);
+            if (!in)
+                return false;
+            std::string name;
+            int value;
+            while (in >> name) {
+                if (name[0] == '#' || !(in >> value)) {
+                    in.clear();
+                    std::getline(in, name);
+                    continue;
+                }
+                if (name == "karatsuba") t.karatsuba = value;
+                else if (name == "parallel_product") t.parallel_product = value;
+            }
+            return true;
+        }
+        static bool validThresholds(const BigIntThresholds& t) {
+            return t.karatsuba >= 2 && t.parallel_product >= 1;
+        }
+        //On first use the thresholds are read from the profile named by the BIGINT_TUNING_PROFILE
+        //environment variable, if it is set and valid. Otherwise the compile-time defaults apply.
+        static Tuning& tuning() {
+            static Tuning t;
+            static std::once_flag flag;
+            std::call_once(flag, [] {
+                BigIntThresholds d, p;
+                const char* path = std::getenv("BIGINT_TUNING_PROFILE");
+                if (path && parseProfile(path, p) && validThresholds(p))
+                    d = p;
+                t.karatsuba = d.karatsuba;
+                t.parallelProduct = d.parallel_product;
+            });
+            return t;
+        }
+        //random number with exactly n digits, for benchmarks
+        static BigInt randomDigits(int n, std::mt19937_64& gen) {
+            BigInt r(n, n, false);
+            for (int i = 0; i < n; ++i)
+                r.arr[i] = gen() % 10;
+            r.arr[n-1] = 1 + gen() % 9;
+            return r;
+        }
+        //best of three runs of f, in seconds
+        template<typename F>
+        static double timeBest(F f) {
+            double best = 1e300;
+            for (int run = 0; run < 3; ++run) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                f();
+                std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+                if (d.count() < best) best = d.count();
+            }
+            return best;
+        }
+        /*-----------------------------Karatsuba multiplication------------------------------
+         * The digits are treated as polynomial coefficients and multiplied without carrying;
+         * a single carry pass at the end turns the coefficients back into digits.
+         */
+        //out[0, 2n) += a[0, n) * b[0, n), where out starts zeroed. If token is set it is checked
+        //at every split; progress, if set, gets done + span * (fraction of this product finished).
+        static void karatsuba(const long long* a, const long long* b, int n, long long* out, int threshold,
+            const CancellationToken* token = NULL, const ProgressCallback* progress = NULL,
+            double done = 0, double span = 1) {
+            if (n < threshold) {
+                for (int i = 0; i < n; ++i)
+                    for (int j = 0; j < n; ++j)
+                        out[i+j] += a[i] * b[j];
+                return;
+            }
+            if (token) token->throw_if_cancelled();
+            //the three sub-products cost about the same; stop reporting once steps get tiny
+            if (progress && span < 1.0 / 1024) progress = NULL;
+            int h = n / 2, h2 = n - h;
+            karatsuba(a, b, h, out, threshold, token, progress, done, span / 3);
+            if (progress) (*progress)(done + span / 3);
+            karatsuba(a + h, b + h, h2, out + 2*h, threshold, token, progress, done + span / 3, span / 3);
+            if (progress) (*progress)(done + 2 * span / 3);
+            std::vector<long long> sa(h2), sb(h2), mid(2*h2, 0);
+            for (int i = 0; i < h2; ++i) {
+                sa[i] = a[h+i] + (i < h? a[i] : 0);
+                sb[i] = b[h+i] + (i < h? b[i] : 0);
+            }
+            karatsuba(sa.data(), sb.data(), h2, mid.data(), threshold, token, progress, done + 2 * span / 3, span / 3);
+            for (int i = 0; i < 2*h; ++i)
+                mid[i] -= out[i];
+            for (int i = 0; i < 2*h2; ++i)
+                mid[i] -= out[2*h + i];
+            for (int i = 0; i < 2*h2; ++i)
+                out[h + i] += mid[i];
+        }
+        //writes the n + m digits of sc * lc to out, where sc has m <= n coefficients and lc has n.
+        //The longer operand is cut into blocks as long as the shorter one. Returns the length
+        //without leading zeros. token and progress are passed on to karatsuba().
+        static int karatsubaDigits(const std::vector<long long>& sc, const std::vector<long long>& lc,
+            s_type* out, int threshold, const CancellationToken* token = NULL,
+            const ProgressCallback* progress = NULL) {
+            int m = sc.size(), n = lc.size();
+            int blocks = (n + m - 1) / m;
+            std::vector<long long> block(m), part(2*m), acc(n + m, 0);
+            for (int lo = 0, k = 0; lo < n; lo += m, ++k) {
+                if (token) token->throw_if_cancelled();
+                if (progress) (*progress)((double)k / blocks);
+                for (int i = 0; i < m; ++i)
+                    block[i] = (lo + i < n)? lc[lo + i] : 0;
+                std::fill(part.begin(), part.end(), 0);
+                karatsuba(block.data(), sc.data(), m, part.data(), threshold, token, progress,
+                    (double)k / blocks, 1.0 / blocks);
+                for (int i = 0; i < 2*m && lo + i < n + m; ++i)
+                    acc[lo + i] += part[i];
+            }
+            long long carry = 0;
+            for (int i = 0; i < n + m; ++i) {
+                carry += acc[i];
+                out[i] = carry % 10;
+                carry /= 10;
+            }
+            int i = n + m;
+            while (i > 1 && out[i-1] == 0) --i;
+            return i;
+        }
+        //|this| * |b| into result, which has room for inUse + b.inUse digits
+        void karatsubaMultiply(const BigInt& b, BigInt& result, int threshold,
+            const CancellationToken* token = NULL, const ProgressCallback* progress = NULL) const {
+            const BigInt& s = (inUse < b.inUse)? *this : b;
+            const BigInt& l = (inUse < b.inUse)? b : *this;
+            std::vector<long long> sc(s.arr, s.arr + s.inUse), lc(l.arr, l.arr + l.inUse);
+            result.inUse = karatsubaDigits(sc, lc, result.arr, threshold, token, progress);
+        }
+        //backs the cancellable multiply(a, b, token, progress) and pow(x, y, token, progress)
+        static BigInt multiplyCancellable(const BigInt& a, const BigInt& b, const CancellationToken& token,
+            const ProgressCallback& progress) {
+            token.throw_if_cancelled();
+            int threshold = tuning().karatsuba;
+            if (a.inUse < threshold || b.inUse < threshold) {
+                BigInt result = BigInt(a).multiply(b);
+                if (progress) progress(1.0);
+                return result;
+            }
+            BigInt result(a.inUse + b.inUse, 1, a.isNeg != b.isNeg);
+            a.karatsubaMultiply(b, result, threshold, &token, progress? &progress : NULL);
+            if (result.isZero()) result.isNeg = false;
+            if (progress) progress(1.0);
+            return result;
+        }
         BigInt multiply (const BigInt& b, bool move = false) {
-            BigInt result(inUse+b.inUse, 0, (b.isNeg? !isNeg : isNeg));
-            if (inUse + b.inUse + 1 < 19)
-                result.move((long long)*this * (long long)b);
+            bool neg = b.isNeg? !isNeg : isNeg;
+            BigInt result(inUse+b.inUse, 1, neg);
+            unsigned long long x, y;
+            //both operands fit in a machine word: multiply natively
+            #ifdef __SIZEOF_INT128__
+            if (inUse < 20 && b.inUse < 20 && toMagnitude(x) && b.toMagnitude(y))
+                result.assignWide((unsigned __int128)x * y, neg);
+            #else
+            if (inUse + b.inUse < 20 && toMagnitude(x) && b.toMagnitude(y))
+                result.assignSmall(x * y, neg);
+            #endif
+            else if (inUse >= tuning().karatsuba && b.inUse >= tuning().karatsuba) {
+                karatsubaMultiply(b, result, tuning().karatsuba);
+                if (result.isZero()) result.isNeg = false;
+            }
             else {
                 std::fill_n(result.arr, result.allocated, 0);
                 int x = 0, y = 0, carry;
@@ -224,269 +469,1131 @@ namespace my {
                 }
                 for (x = result.allocated-1; x > 0 && result.arr[x] == 0; --x);
                 result.inUse = x+1;
+                if (result.isZero()) result.isNeg = false;
             }
             
             if (move) this->move(std::forward<BigInt&&>(result));
             return result;
         }
-        BigInt multiply(long& n, bool move = false) {
-            BigInt result(inUse+4, 0, (n < 0? !isNeg : isNeg));
-            long x = (n < 0)? -n : n;
-            long long carry = 0;
-            int i = 0;
-            for(; i < inUse; ++i) {
-                carry = arr[i] * x + carry;
-                result.arr[i] = carry % 10;
-                carry /= 10;
+        //this = a + b (or a - b) as native integers when both are below 10^18, so the sum
+        //cannot overflow. Returns false, leaving this unchanged, if they are too long.
+        bool addNative(const BigInt& a, const BigInt& b, bool subtract) {
+            if (a.inUse > 18 || b.inUse > 18)
+                return false;
+            unsigned long long x, y;
+            a.toMagnitude(x); b.toMagnitude(y);
+            long long r = (a.isNeg? -(long long)x : (long long)x) +
+                ((b.isNeg != subtract)? -(long long)y : (long long)y);
+            assignSmall((r < 0)? 0ULL - (unsigned long long)r : r, r < 0);
+            return true;
+        }
+        /* Schoolbook long division of the magnitudes. Each quotient digit is estimated from the
+         * leading (up to 18) digits of the running remainder and the leading 17 digits of the
+         * divisor. The estimate is never too small and is rarely too big; when it is, the
+         * divisor is added back.
+         */
+        void divmodMagnitude(const BigInt& b, BigInt* quotient, BigInt* remainder) const {
+            int n = inUse, m = b.inUse;
+            int k = (m < 17)? m : 17, s = m - k;
+            unsigned long long lead = 0;
+            for (int j = m-1; j >= s; --j)
+                lead = lead * 10 + b.arr[j];
+
+            BigInt q(n, n, false), r(m+2, 1, false);
+            std::fill_n(r.arr, r.allocated, 0);
+            int rlen = 0;   //length of the running remainder without leading zeros
+            for (int i = n-1; i >= 0; --i) {
+                for (int j = rlen; j > 0; --j)
+                    r.arr[j] = r.arr[j-1];
+                r.arr[0] = arr[i];
+                if (rlen > 0 || arr[i] != 0) ++rlen;
+
+                int qd = 0;
+                if (compare_help(r.arr, rlen, b.arr, m) >= 0) {
+                    unsigned long long top = 0;
+                    for (int j = rlen-1; j >= s; --j)
+                        top = top * 10 + r.arr[j];
+                    qd = (top / lead > 9)? 9 : (int)(top / lead);
+
+                    int borrow = 0;
+                    for (int j = 0; j < rlen; ++j) {
+                        int t = r.arr[j] - qd * (j < m? b.arr[j] : 0) - borrow;
+                        borrow = (t < 0)? (9 - t) / 10 : 0;
+                        r.arr[j] = t + borrow * 10;
+                    }
+                    while (borrow) {
+                        --qd;
+                        int carry = 0;
+                        for (int j = 0; j < rlen; ++j) {
+                            int t = r.arr[j] + (j < m? b.arr[j] : 0) + carry;
+                            carry = t / 10;
+                            r.arr[j] = t % 10;
+                        }
+                        borrow -= carry;
+                    }
+                    while (rlen > 0 && r.arr[rlen-1] == 0) --rlen;
+                }
+                q.arr[i] = qd;
             }
-            while (carry) {
-                if (i == result.allocated) {
-                    result.inUse = i;
-                    result.growArray(4);
-                } 
-                result.arr[i++] = carry%10;
-                carry /= 10;
+            if (quotient) {
+                while (q.inUse > 1 && q.arr[q.inUse-1] == 0) --q.inUse;
+                quotient->move(std::move(q));
+            }
+            if (remainder) {
+                r.inUse = (rlen == 0)? 1 : rlen;
+                remainder->move(std::move(r));
+            }
+        }
+        BigInt divide(const BigInt& b, bool move = false) {
+            if (b.isZero())
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            BigInt result;
+            unsigned long long d;
+            //a divisor that fits in a machine word needs a single pass of short division
+            if (b.toMagnitude(d)) {
+                result = *this;
+                result.divSmallSigned(d, b.isNeg);
+            }
+            else if (compare_help(arr, inUse, b.arr, b.inUse) >= 0) {
+                divmodMagnitude(b, &result, NULL);
+                result.isNeg = (isNeg != b.isNeg) && !result.isZero();
             }
-            result.inUse = i;
-            std::fill_n(result.arr+i, result.allocated-i, 0);
             if (move) this->move(std::forward<BigInt&&>(result));
             return result;
         }
-        BigInt divide(long& divisor, bool move = false) {
-            if (divisor == 0)
+        BigInt modulo3(const BigInt& b, bool move = false) {
+            if (b.isZero())
                 throw divisionByZero("Error In BigInt: divisionByZero check\n");
             BigInt result;
-            if (divisor == 1)
+            unsigned long long d;
+            if (b.toMagnitude(d))
+                result.assignSmall(modSmall(d), isNeg);
+            else if (compare_help(arr, inUse, b.arr, b.inUse) < 0)
                 result = *this;
-            else if (inUse > 1 && inUse < 19)
-                result.move((long long)*this / divisor);
             else {
-                bool neg = divisor < 0? !isNeg : isNeg;
-                if (divisor < 0)
-                    divisor = -divisor;
-                if (inUse == 1) {
-                    int q = arr[0] / divisor;
-                    if (q > 0) result.isNeg = neg;
-                    result.arr[0] = q;
+                divmodMagnitude(b, NULL, &result);
+                result.isNeg = isNeg && !result.isZero();
+            }
+            if (move) this->move(std::forward<BigInt&&>(result));
+            return result;
+        }
+        /*----------------Single-digit-pass kernels for small multipliers/divisors------------*/
+        //this = this*m + a, ignoring the sign. m must not exceed 10^18 and a must not exceed m.
+        void mulAddSmall(unsigned long long m, unsigned long long a) {
+            unsigned long long carry = a;
+            int i = 0;
+            for (; i < inUse; ++i) {
+                carry += arr[i] * m;
+                arr[i] = carry % 10;
+                carry /= 10;
+            }
+            while (carry) {
+                if (i == allocated) {
+                    inUse = i;
+                    growArray(inUse + 8);
+                }
+                arr[i++] = carry % 10;
+                carry /= 10;
+            }
+            inUse = i;
+            while (inUse > 1 && arr[inUse-1] == 0) --inUse;
+            std::fill_n(arr+inUse, allocated-inUse, 0);
+        }
+        //this = this/d, ignoring the sign. Returns the remainder. d must not exceed 10^18.
+        unsigned long long divSmall(unsigned long long d) {
+            unsigned long long rem = 0;
+            for (int i = inUse-1; i >= 0; --i) {
+                rem = rem * 10 + arr[i];
+                arr[i] = rem / d;
+                rem %= d;
+            }
+            while (inUse > 1 && arr[inUse-1] == 0) --inUse;
+            if (inUse == 1 && arr[0] == 0) isNeg = false;
+            return rem;
+        }
+        /*-----------------Kernels for mixed arithmetic with built-in integers-----------------
+         * The built-in operand is passed as a magnitude and a sign so that the minimum value of
+         * every signed type and the whole range of unsigned long long are handled.
+         */
+        template<typename T>
+        static void splitSmall(T t, unsigned long long& mag, bool& neg) {
+            neg = std::is_signed<T>::value && t < T(0);
+            mag = neg? 0ULL - (unsigned long long)t : (unsigned long long)t;
+        }
+        bool isZero() const {
+            return inUse == 1 && arr[0] == 0;
+        }
+        //stores |this| in m. Returns false if it does not fit in an unsigned long long.
+        bool toMagnitude(unsigned long long& m) const {
+            if (inUse > 20)
+                return false;
+            m = 0;
+            for (int i = inUse-1; i >= 0; --i) {
+                if (m > (18446744073709551615ULL - arr[i]) / 10)
+                    return false;
+                m = m * 10 + arr[i];
+            }
+            return true;
+        }
+        //writes m in place, reallocating only if the array is too small
+        void assignSmall(unsigned long long m, bool neg) {
+            int n = 0;
+            for (unsigned long long t = m; n == 0 || t; t /= 10) ++n;
+            if (allocated < n) {
+                delete [] arr;
+                allocated = n;
+                arr = new s_type[allocated];
+            }
+            inUse = 0;
+            do {
+                arr[inUse++] = m % 10;
+                m /= 10;
+            } while (m);
+            std::fill_n(arr+inUse, allocated-inUse, 0);
+            isNeg = neg && !isZero();
+        }
+        #ifdef __SIZEOF_INT128__
+        //like assignSmall, for m below 10^38 (any product of two unsigned long longs below 10^19)
+        void assignWide(unsigned __int128 m, bool neg) {
+            if ((m >> 64) == 0) {
+                assignSmall((unsigned long long)m, neg);
+                return;
+            }
+            const unsigned long long p19 = 10000000000000000000ULL;
+            unsigned long long lo = (unsigned long long)(m % p19), hi = (unsigned long long)(m / p19);
+            int n = 19;
+            for (unsigned long long t = hi; t; t /= 10) ++n;
+            if (allocated < n) {
+                delete [] arr;
+                allocated = n;
+                arr = new s_type[allocated];
+            }
+            for (inUse = 0; inUse < 19; ++inUse, lo /= 10)
+                arr[inUse] = lo % 10;
+            for (; hi; hi /= 10)
+                arr[inUse++] = hi % 10;
+            std::fill_n(arr+inUse, allocated-inUse, 0);
+            isNeg = neg;
+        }
+        #endif
+        int compareSmall(unsigned long long m, bool neg) const {
+            bool thisNeg = isNeg && !isZero();
+            neg = neg && m;
+            if (thisNeg != neg)
+                return thisNeg? -1 : 1;
+            s_type d[20];
+            int n = 0;
+            do {
+                d[n++] = m % 10;
+                m /= 10;
+            } while (m);
+            int c = compare_help(arr, inUse, d, n);
+            return neg? -c : c;
+        }
+        //|this| += m
+        void addMagnitude(unsigned long long m) {
+            int i = 0, carry = 0;
+            while (m || carry) {
+                if (i == allocated)
+                    growArray(4);
+                int sum = (i < inUse? arr[i] : 0) + (int)(m % 10) + carry;
+                arr[i++] = sum % 10;
+                carry = sum / 10;
+                m /= 10;
+                if (i > inUse) inUse = i;
+            }
+            std::fill_n(arr+inUse, allocated-inUse, 0);
+        }
+        //|this| = ||this| - m|, flipping the sign if m is the larger one
+        void subMagnitude(unsigned long long m) {
+            unsigned long long v;
+            if (toMagnitude(v) && v < m) {
+                assignSmall(m - v, !isNeg);
+                return;
+            }
+            int i = 0, borrow = 0;
+            while (m || borrow) {
+                int sub = arr[i] - (int)(m % 10) - borrow;
+                borrow = (sub < 0)? 1 : 0;
+                arr[i++] = borrow? sub + 10 : sub;
+                m /= 10;
+            }
+            while (inUse > 1 && arr[inUse-1] == 0) --inUse;
+            if (isZero()) isNeg = false;
+        }
+        void addSmall(unsigned long long m, bool neg) {
+            if (m == 0)
+                return;
+            if (isZero())
+                assignSmall(m, neg);
+            else if (isNeg == neg)
+                addMagnitude(m);
+            else
+                subMagnitude(m);
+        }
+        void mulSmall(unsigned long long m, bool neg) {
+            if (m == 0 || isZero()) {
+                assignSmall(0, false);
+                return;
+            }
+            bool resNeg = isNeg != neg;
+            if (m <= 1000000000000000000ULL)
+                mulAddSmall(m, 0);
+            else {
+                #ifdef __SIZEOF_INT128__
+                unsigned __int128 carry = 0;
+                int i = 0;
+                for (; i < inUse; ++i) {
+                    carry += (unsigned __int128)arr[i] * m;
+                    arr[i] = (s_type)(carry % 10);
+                    carry /= 10;
                 }
-                else {
-                    auto a = new s_type[inUse];
-                    int i = inUse-1, j = 0;
-                    long long temp = arr[i];
-                    while (temp < divisor)
-                        temp = temp * 10 + (arr[--i]);
-
-                    while (i >= 0) {
-                        a[j++] = (temp / divisor);
-                        temp = (temp % divisor) * 10 + arr[--i];
+                for (; carry; carry /= 10) {
+                    if (i == allocated) {
+                        inUse = i;
+                        growArray(8);
+                    }
+                    arr[i++] = (s_type)(carry % 10);
+                }
+                inUse = i;
+                std::fill_n(arr+inUse, allocated-inUse, 0);
+                #else
+                this->move(multiply(BigInt(m)));
+                #endif
+            }
+            isNeg = resNeg;
+        }
+        //|this| mod d, leaving this unchanged
+        unsigned long long modSmall(unsigned long long d) const {
+            if (d <= 1000000000000000000ULL) {
+                unsigned long long rem = 0;
+                for (int i = inUse-1; i >= 0; --i)
+                    rem = (rem * 10 + arr[i]) % d;
+                return rem;
+            }
+            #ifdef __SIZEOF_INT128__
+            unsigned __int128 rem = 0;
+            for (int i = inUse-1; i >= 0; --i)
+                rem = (rem * 10 + arr[i]) % d;
+            return (unsigned long long)rem;
+            #else
+            unsigned long long rem = 0;
+            BigInt r;
+            divmodMagnitude(BigInt(d), NULL, &r);
+            r.toMagnitude(rem);
+            return rem;
+            #endif
+        }
+        void divSmallSigned(unsigned long long m, bool neg) {
+            if (m == 0)
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            bool resNeg = isNeg != neg;
+            if (m <= 1000000000000000000ULL)
+                divSmall(m);
+            else {
+                #ifdef __SIZEOF_INT128__
+                unsigned __int128 rem = 0;
+                for (int i = inUse-1; i >= 0; --i) {
+                    rem = rem * 10 + arr[i];
+                    arr[i] = (s_type)(rem / m);
+                    rem %= m;
+                }
+                while (inUse > 1 && arr[inUse-1] == 0) --inUse;
+                #else
+                BigInt q;
+                divmodMagnitude(BigInt(m), &q, NULL);
+                this->move(std::move(q));
+                #endif
+            }
+            isNeg = resNeg && !isZero();
+        }
+        /*--------------------------Byte import and export helpers--------------------------*/
+        static bool nativeLittleEndian() {
+            unsigned short probe = 1;
+            return *(unsigned char*)&probe == 1;
+        }
+        //magnitude from n bytes, least significant byte first. Converts 7 bytes per pass.
+        static BigInt fromLittleEndian(const unsigned char* b, size_t n) {
+            while (n > 0 && b[n-1] == 0) --n;
+            BigInt result((int)(n * 2.41) + 2, 1, false);
+            std::fill_n(result.arr, result.allocated, 0);
+            size_t top = n % 7;
+            if (top == 0 && n > 0) top = 7;
+            for (size_t end = n; end > 0; end -= top, top = 7) {
+                unsigned long long chunk = 0;
+                for (size_t i = end; i > end - top; --i)
+                    chunk = (chunk << 8) | b[i-1];
+                result.mulAddSmall(1ULL << (8 * top), chunk);
+            }
+            return result;
+        }
+        //magnitude as bytes, least significant byte first, without trailing zero bytes.
+        void toLittleEndian(std::vector<unsigned char>& out) const {
+            out.clear();
+            out.reserve(inUse * 5 / 12 + 8);
+            BigInt temp = *this;
+            while (temp.inUse > 1 || temp.arr[0] > 0) {
+                unsigned long long chunk = temp.divSmall(1ULL << 56);
+                for (int i = 0; i < 7; ++i, chunk >>= 8)
+                    out.push_back(chunk & 0xFF);
+            }
+            while (!out.empty() && out.back() == 0)
+                out.pop_back();
+        }
+        //size, order and endian as import_words and export_words accept them
+        static void checkWordFormat(size_t size, int order, int endian, const char* where) {
+            if (size == 0 || (order != 1 && order != -1) || endian < -1 || endian > 1)
+                throw invalidArgument(where);
+        }
+        /*------------------------------Radix conversion helpers------------------------------*/
+        static void checkBase(int base, const char* where) {
+            if (base < 2 || base > 36)
+                throw invalidArgument(where);
+        }
+        //value of an alphanumeric digit, or 36 for anything else
+        static int radixDigit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+            return 36;
+        }
+        //k if base == 2^k, otherwise 0
+        static int log2Base(int base) {
+            int k = 0;
+            while ((1 << k) < base) ++k;
+            return ((1 << k) == base)? k : 0;
+        }
+        //the largest count with base^count <= 10^18, and base^count
+        static int chunkDigits(int base, unsigned long long& power) {
+            int count = 0;
+            for (power = 1; power <= 1000000000000000000ULL / base; power *= base)
+                ++count;
+            return count;
+        }
+        //magnitude in base 2^k: the binary form is cut into k-bit digits in a single pass.
+        std::string toPowerOfTwoBase(int k) const {
+            static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+            std::vector<unsigned char> b;
+            toLittleEndian(b);
+            b.push_back(0);
+            std::string s;
+            size_t bits = (b.size() - 1) * 8;
+            s.reserve(bits / k + 1);
+            for (size_t pos = 0; pos < bits; pos += k) {
+                unsigned int window = b[pos/8] | (pos/8 + 1 < b.size()? b[pos/8 + 1] << 8 : 0);
+                s.push_back(digits[(window >> (pos % 8)) & ((1u << k) - 1)]);
+            }
+            while (s.size() > 1 && s.back() == '0') s.pop_back();
+            if (s.empty()) s = "0";
+            return std::string(s.rbegin(), s.rend());
+        }
+        /* magnitude in any other base, peeling off as many digits as fit in 10^18 per pass.
+         * This stays quadratic on purpose: a divide-and-conquer split would need a division
+         * faster than divmodMagnitude's schoolbook one, which is slower than these passes.
+         */
+        std::string toOtherBase(int base) const {
+            static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+            unsigned long long power;
+            int count = chunkDigits(base, power);
+            std::string s;
+            BigInt temp = *this;
+            do {
+                unsigned long long chunk = temp.divSmall(power);
+                for (int i = 0; i < count; ++i, chunk /= base)
+                    s.push_back(digits[chunk % base]);
+            } while (!temp.isZero());
+            while (s.size() > 1 && s.back() == '0') s.pop_back();
+            return std::string(s.rbegin(), s.rend());
+        }
+        //magnitude from digits [begin, end), already checked to be valid in base 2^k.
+        static BigInt fromPowerOfTwoBase(const char* begin, const char* end, int k) {
+            std::vector<unsigned char> b(((end - begin) * k + 7) / 8 + 1, 0);
+            size_t pos = 0;
+            for (const char* c = end; c != begin; pos += k) {
+                unsigned int v = radixDigit(*--c);
+                b[pos/8] |= (v << (pos % 8)) & 0xFF;
+                if ((pos % 8) + k > 8)
+                    b[pos/8 + 1] |= v >> (8 - pos % 8);
+            }
+            return fromLittleEndian(b.data(), b.size());
+        }
+        //magnitude from digits [begin, end), one word-sized chunk at a time: quadratic.
+        static BigInt fromOtherBaseChunked(const char* begin, const char* end, int base) {
+            unsigned long long power;
+            int count = chunkDigits(base, power);
+            BigInt result((int)((end - begin) * std::log10((double)base)) + 2, 1, false);
+            std::fill_n(result.arr, result.allocated, 0);
+            int first = (end - begin) % count;
+            if (first == 0) first = count;
+            for (const char* c = begin; c != end; first = count) {
+                unsigned long long chunk = 0, scale = 1;
+                for (int i = 0; i < first; ++i, ++c) {
+                    chunk = chunk * base + radixDigit(*c);
+                    scale *= base;
+                }
+                result.mulAddSmall(scale, chunk);
+            }
+            return result;
+        }
+        //value = high part * base^(count * 2^level) + low part, where powers[level] holds that power
+        static BigInt fromOtherBaseSplit(const char* begin, const char* end, int base, int count,
+            const std::vector<BigInt>& powers, int level, long cutoff) {
+            if (end - begin <= cutoff || level < 0)
+                return fromOtherBaseChunked(begin, end, base);
+            long m = (long)count << level;
+            if (end - begin <= m)
+                return fromOtherBaseSplit(begin, end, base, count, powers, level - 1, cutoff);
+            BigInt result = fromOtherBaseSplit(begin, end - m, base, count, powers, level - 1, cutoff);
+            result *= powers[level];
+            result += fromOtherBaseSplit(end - m, end, base, count, powers, level - 1, cutoff);
+            return result;
+        }
+        /* Splits the digits in halves until the pieces are short enough for the chunked pass,
+         * then joins them with multiplications by powers of the base. The joins run on the
+         * Karatsuba tier, but the chunked pass handles 18 digits per step, so splitting only
+         * wins on pieces of about 512 times the Karatsuba threshold (24k digits by default).
+         */
+        static BigInt fromOtherBase(const char* begin, const char* end, int base) {
+            unsigned long long power;
+            int count = chunkDigits(base, power);
+            long cutoff = (long)(512.0 * tuning().karatsuba / std::log10((double)base));
+            if (end - begin <= cutoff)
+                return fromOtherBaseChunked(begin, end, base);
+            std::vector<BigInt> powers(1, BigInt(power));
+            while (((long)count << powers.size()) < end - begin)
+                powers.push_back(powers.back() * powers.back());
+            return fromOtherBaseSplit(begin, end, base, count, powers, (int)powers.size() - 1, cutoff);
+        }
+        /*------------------------------Exact division helpers-------------------------------*/
+        int trailingZeros() const {
+            int i = 0;
+            while (i < inUse - 1 && arr[i] == 0) ++i;
+            return i;
+        }
+        //the largest power of p (2 or 5) that fits in a word below 10^18, and its exponent
+        static unsigned long long factorChunk(unsigned int p, int& exponent) {
+            exponent = (p == 2)? 59 : 25;
+            unsigned long long c = 1;
+            for (int i = 0; i < exponent; ++i) c *= p;
+            return c;
+        }
+        //divides |this| by the largest power of p (2 or 5) that divides it and returns the exponent
+        unsigned long long stripFactor(unsigned int p) {
+            int e;
+            unsigned long long chunk = factorChunk(p, e), count = 0;
+            while (!isZero()) {
+                unsigned long long r = modSmall(chunk), f = 1;
+                if (r == 0) {
+                    divSmall(chunk);
+                    count += e;
+                    continue;
+                }
+                for (; r % p == 0; r /= p, f *= p)
+                    ++count;
+                if (f > 1) divSmall(f);
+                break;
+            }
+            return count;
+        }
+        //|this| = |this| / p^e, where p^e divides it
+        void divPower(unsigned int p, unsigned long long e) {
+            int ce;
+            unsigned long long chunk = factorChunk(p, ce);
+            for (; e >= (unsigned long long)ce; e -= ce)
+                divSmall(chunk);
+            unsigned long long f = 1;
+            for (; e > 0; --e) f *= p;
+            if (f > 1) divSmall(f);
+        }
+        //whether p^e (p is 2 or 5) divides |this|. Only the last e digits matter, since 10^e is
+        //a multiple of p^e.
+        bool divisibleByPower(unsigned int p, unsigned long long e) const {
+            if (isZero() || e == 0)
+                return true;
+            if (e >= 4ULL * inUse)      //0 < |this| < 10^inUse < p^e
+                return false;
+            int n = (e < (unsigned long long)inUse)? (int)e : inUse;
+            BigInt low(n, n, false);
+            std::copy(arr, arr + n, low.arr);
+            while (low.inUse > 1 && low.arr[low.inUse-1] == 0) --low.inUse;
+            return low.isZero() || low.stripFactor(p) >= e;
+        }
+        static std::vector<unsigned long long> toLimbs9(const BigInt& b) {
+            std::vector<unsigned long long> limbs((b.inUse + 8) / 9, 0);
+            for (int i = b.inUse - 1; i >= 0; --i)
+                limbs[i / 9] = limbs[i / 9] * 10 + b.arr[i];
+            return limbs;
+        }
+        /* Hensel division in base 10^9 (Jebelean's exact division): quotient limbs come from the
+         * least significant end as q_i = r_i * c_0^-1 mod 10^9, so there is no estimation and no
+         * correction step. c must be coprime to 10. With quotient set, c is assumed to divide
+         * |this| and only the limbs that affect the quotient are updated. With quotient NULL, the
+         * whole remainder is kept and the return value says whether c divides |this|.
+         */
+        bool hensel(const BigInt& c, BigInt* quotient) const {
+            const unsigned long long B = 1000000000ULL;
+            std::vector<unsigned long long> r = toLimbs9(*this), cl = toLimbs9(c);
+            int N = r.size(), M = cl.size();
+            if (N < M) {
+                if (quotient) *quotient = BigInt();
+                return isZero();
+            }
+            int Q = N - M + 1, limit = quotient? Q : N;
+            //inverse of the lowest limb modulo 10^9 by Newton's iteration, from the inverse mod 10
+            unsigned long long inv = (cl[0] % 10 == 3)? 7 : (cl[0] % 10 == 7)? 3 : cl[0] % 10;
+            for (int i = 0; i < 5; ++i)
+                inv = inv * ((B + 2 - cl[0] * inv % B) % B) % B;
+            std::vector<unsigned long long> q(Q);
+            for (int i = 0; i < Q; ++i) {
+                q[i] = r[i] * inv % B;
+                unsigned long long carry = 0;
+                int k = i;
+                for (int j = 0; j < M && k < limit; ++j, ++k) {
+                    unsigned long long prod = q[i] * cl[j] + carry, low = prod % B;
+                    carry = prod / B;
+                    if (r[k] < low) {
+                        r[k] += B - low;
+                        ++carry;
                     }
-                    if (j == 1) {
-                        if (a[0] > 0) result.isNeg = neg;
-                        result.arr[0] = a[0];
+                    else
+                        r[k] -= low;
+                }
+                for (; carry && k < limit; ++k) {
+                    if (r[k] < carry) {
+                        r[k] += B - carry;
+                        carry = 1;
                     }
                     else {
-                        delete [] result.arr;
-                        result.allocated = j; result.inUse = 0;
-                        result.arr = new s_type[j];
-                        for (--j; j >= 0; --j)
-                            result.arr[result.inUse++] = a[j];
-                        result.isNeg = neg;
+                        r[k] -= carry;
+                        carry = 0;
                     }
-                    delete [] a;
                 }
+                if (!quotient && carry)
+                    return false;       //c * q > |this|
             }
-            if (move) this->move(std::forward<BigInt&&>(result));
+            if (!quotient) {
+                for (int k = Q; k < N; ++k)
+                    if (r[k]) return false;
+                return true;
+            }
+            BigInt result(9 * Q, 9 * Q, false);
+            for (int i = 0; i < Q; ++i)
+                for (int d = 0; d < 9; ++d, q[i] /= 10)
+                    result.arr[9*i + d] = q[i] % 10;
+            while (result.inUse > 1 && result.arr[result.inUse-1] == 0) --result.inUse;
+            *quotient = std::move(result);
+            return true;
+        }
+        /*-----------------------Bitwise helpers (two's complement)------------------------*/
+        static void negateBytes(std::vector<unsigned char>& b) {
+            unsigned int carry = 1;
+            for (size_t i = 0; i < b.size(); ++i) {
+                carry += (unsigned char)~b[i];
+                b[i] = carry & 0xFF;
+                carry >>= 8;
+            }
+        }
+        //Applies op to the infinite two's complement forms of this and b, as Python and GMP do.
+        //Both are sign extended one byte past the longer magnitude, which is enough to hold
+        //the sign of the result.
+        BigInt bitwise(const BigInt& b, char op) const {
+            std::vector<unsigned char> x, y;
+            toLittleEndian(x);
+            b.toLittleEndian(y);
+            size_t n = ((x.size() > y.size())? x.size() : y.size()) + 1;
+            x.resize(n, 0); y.resize(n, 0);
+            bool xNeg = isNeg && !isZero(), yNeg = b.isNeg && !b.isZero();
+            if (xNeg) negateBytes(x);
+            if (yNeg) negateBytes(y);
+            bool neg = false;
+            for (size_t i = 0; i < n; ++i) {
+                if (op == '&') x[i] &= y[i];
+                else if (op == '|') x[i] |= y[i];
+                else x[i] ^= y[i];
+            }
+            if (op == '&') neg = xNeg && yNeg;
+            else if (op == '|') neg = xNeg || yNeg;
+            else neg = xNeg != yNeg;
+            if (neg) negateBytes(x);
+            BigInt result = fromLittleEndian(x.data(), x.size());
+            result.isNeg = neg && !result.isZero();
             return result;
         }
-        void divide_modulo_helper(const BigInt& b, s_type* quotient, s_type* temp, int& j, int &t_pos, int &m) {
-
-            /* Strategy: Get a number E with as many digits from N as their are in D
-            * (get one more digit if E is smaller than the divisor). Use repeated subtraction
-            * to divide E by D and append the quotient to result. Let E be the remainder left
-            * from division. Append as many elements in D to it. Repeat the division.
-            */ 
-            int pos = inUse;
-
-            //loop till number of elements left is fewer than number of elements
-            // we need to divide with.
-            while (pos > 0) {
-
-                //if we have b.inUse length of remainders, get one more digit since the remainder
-                //is guaranteed to be less than b.
-                if (pos < t_pos - 1) {
-                    quotient[j++] = 0;
-                    break;
+        //by squaring, so large powers use Karatsuba
+        static BigInt powerOfTwo(size_t i) {
+            if (i < 64)
+                return BigInt(1ULL << i);
+            if (i <= std::numeric_limits<unsigned int>::max())
+                return pow(BigInt(2), (unsigned int)i);
+            std::vector<unsigned char> b(i/8 + 1, 0);
+            b[i/8] = 1 << (i%8);
+            return fromLittleEndian(b.data(), b.size());
+        }
+        static size_t popcountBytes(const std::vector<unsigned char>& b) {
+            size_t count = 0;
+            for (size_t i = 0; i < b.size(); ++i) {
+                for (unsigned char c = b[i]; c; c &= c-1)
+                    ++count;
+            }
+            return count;
+        }
+        /*--------------------------------Primality helpers---------------------------------*/
+        //odd primes below 65536, computed once
+        static const std::vector<unsigned int>& smallPrimes() {
+            static std::vector<unsigned int> primes;
+            static std::once_flag flag;
+            std::call_once(flag, [] {
+                std::vector<bool> composite(65536, false);
+                for (unsigned int i = 3; i < 65536; i += 2) {
+                    if (composite[i]) continue;
+                    primes.push_back(i);
+                    for (unsigned int j = i * i; j < 65536; j += 2 * i)
+                        composite[j] = true;
                 }
-                if (t_pos == 1)
-                    temp[--t_pos] = arr[--pos];
-                //else get an extra t_pos-1 digits.
-                else {
-                    while (t_pos > 1)
-                        temp[--t_pos] = arr[--pos];
+            });
+            return primes;
+        }
+        //residues of |this| modulo the first count small primes. Primes are grouped into
+        //products below 10^18 so each group costs a single pass over the digits.
+        void smallResidues(size_t count, std::vector<unsigned int>& res) const {
+            const std::vector<unsigned int>& primes = smallPrimes();
+            res.resize(count);
+            for (size_t i = 0; i < count; ) {
+                unsigned long long prod = primes[i];
+                size_t j = i + 1;
+                while (j < count && prod <= 1000000000000000000ULL / primes[j])
+                    prod *= primes[j++];
+                unsigned long long r = modSmall(prod);
+                for (; i < j; ++i)
+                    res[i] = r % primes[i];
+            }
+        }
+        static int jacobiSmall(unsigned long long a, unsigned long long n) {
+            int j = 1;
+            a %= n;
+            while (a) {
+                while (a % 2 == 0) {
+                    a /= 2;
+                    if (n % 8 == 3 || n % 8 == 5) j = -j;
                 }
+                unsigned long long t = a; a = n; n = t;
+                if (a % 4 == 3 && n % 4 == 3) j = -j;
+                a %= n;
+            }
+            return (n == 1)? j : 0;
+        }
+        //Jacobi symbol (D/n) for odd positive n
+        int jacobi(long long D) const {
+            int j = 1;
+            unsigned long long a = (D < 0)? 0ULL - (unsigned long long)D : D;
+            if (D < 0 && modSmall(4) == 3) j = -j;
+            while (a && a % 2 == 0) {
+                a /= 2;
+                unsigned long long r = modSmall(8);
+                if (r == 3 || r == 5) j = -j;
+            }
+            if (a == 0)
+                return (inUse == 1 && arr[0] == 1)? 1 : 0;
+            if (a % 4 == 3 && modSmall(4) == 3) j = -j;
+            return j * jacobiSmall(modSmall(a), a);
+        }
+        /* Montgomery arithmetic modulo an N coprime to 10. The digits are regrouped into limbs of
+         * nine decimal digits and R = 10^(9k) for k limbs, so reduction clears one limb per step
+         * without trial quotients. Numbers in Montgomery form are k-limb vectors, least
+         * significant first.
+         */
+        struct Montgomery {
+            static const unsigned long long base = 1000000000ULL;
+            std::vector<unsigned int> n;
+            int k;
+            unsigned long long ninv;    //-N^-1 mod 10^9
+            std::vector<unsigned long long> t;
+            const BigInt* N;            //must outlive this
 
-                int diff = compare_help(temp+t_pos, m-t_pos, b.arr, b.inUse);
-                if (diff == 0) {
-                    quotient[j++] = 1;
-                    t_pos = m;
-                }    
-                else {
-                    if (diff < 0) {
-                        quotient[j++] = 0;
-                        if (pos == 0) break;
-                        //get an extra digit since temp is less than b.
-                        temp[--t_pos] = arr[--pos];
+            Montgomery(const BigInt& b): k((b.inUse + 8) / 9), t(k + 2), N(&b) {
+                n = toLimbs(b);
+                static const unsigned long long inverse[10] = {0, 1, 0, 7, 0, 0, 0, 3, 0, 9};
+                //Newton iteration doubles the number of correct digits of N^-1 each step
+                unsigned long long x = inverse[n[0] % 10];
+                for (int i = 0; i < 4; ++i)
+                    x = x * ((2 + base - (unsigned long long)n[0] * x % base) % base) % base;
+                ninv = (base - x) % base;
+            }
+            std::vector<unsigned int> toLimbs(const BigInt& x) const {
+                std::vector<unsigned int> v(k, 0);
+                for (int i = x.inUse-1; i >= 0; --i)
+                    v[i/9] = v[i/9] * 10 + x.arr[i];
+                return v;
+            }
+            //out = a*b/R mod N (coarsely integrated operand scanning)
+            void mul(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b, std::vector<unsigned int>& out) {
+                std::fill(t.begin(), t.end(), 0);
+                for (int i = 0; i < k; ++i) {
+                    unsigned long long carry = 0, cur;
+                    for (int j = 0; j < k; ++j) {
+                        cur = t[j] + (unsigned long long)a[i] * b[j] + carry;
+                        t[j] = cur % base;
+                        carry = cur / base;
                     }
-                        
-                    s_type* t = temp+t_pos; //used to offset the array for when t_pos == 1 || 0
-                    int q = 0, i = m-t_pos;
-                        
-                    //Perform division by repeated subtraction
-                    while (i > b.inUse || (i == b.inUse && t[i-1] > b.arr[i-1])) {
-                        i = doSubtract(t, i, b.arr, b.inUse, t);
-                        ++q;
+                    cur = t[k] + carry;
+                    t[k] = cur % base;
+                    t[k+1] = cur / base;
+
+                    unsigned long long m = t[0] * ninv % base;
+                    carry = (t[0] + m * n[0]) / base;
+                    for (int j = 1; j < k; ++j) {
+                        cur = t[j] + m * n[j] + carry;
+                        t[j-1] = cur % base;
+                        carry = cur / base;
                     }
-                    if (i == b.inUse) {
-                        int n = compare_help(t, i, b.arr, i);
-                        if (n > 0) {
-                            i = doSubtract(t, i, b.arr, b.inUse, t);
-                            ++q;
-                        }
-                        else if (n == 0) {
-                            i = 0; ++q;
-                        }
+                    cur = t[k] + carry;
+                    t[k-1] = cur % base;
+                    t[k] = t[k+1] + cur / base;
+                }
+                //the result is below 2N: subtract N once if needed
+                bool geq = t[k] != 0;
+                if (!geq) {
+                    int i = k-1;
+                    while (i >= 0 && t[i] == n[i]) --i;
+                    geq = (i < 0) || t[i] > n[i];
+                }
+                out.resize(k);
+                long long borrow = 0;
+                for (int i = 0; i < k; ++i) {
+                    long long d = (long long)t[i] - (geq? n[i] : 0) - borrow;
+                    borrow = (d < 0)? 1 : 0;
+                    out[i] = (unsigned int)(borrow? d + (long long)base : d);
+                }
+            }
+            //out = a + b mod N
+            void add(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b, std::vector<unsigned int>& out) {
+                out.resize(k);
+                unsigned long long carry = 0;
+                for (int i = 0; i < k; ++i) {
+                    carry += (unsigned long long)a[i] + b[i];
+                    out[i] = carry % base;
+                    carry /= base;
+                }
+                int i = k-1;
+                if (!carry) {
+                    while (i >= 0 && out[i] == n[i]) --i;
+                    if (i >= 0 && out[i] < n[i]) return;
+                }
+                long long borrow = 0;
+                for (i = 0; i < k; ++i) {
+                    long long d = (long long)out[i] - n[i] - borrow;
+                    borrow = (d < 0)? 1 : 0;
+                    out[i] = (unsigned int)(borrow? d + (long long)base : d);
+                }
+            }
+            //out = a - b mod N
+            void sub(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b, std::vector<unsigned int>& out) {
+                out.resize(k);
+                long long borrow = 0;
+                for (int i = 0; i < k; ++i) {
+                    long long d = (long long)a[i] - b[i] - borrow;
+                    borrow = (d < 0)? 1 : 0;
+                    out[i] = (unsigned int)(borrow? d + (long long)base : d);
+                }
+                if (borrow) {
+                    unsigned long long carry = 0;
+                    for (int i = 0; i < k; ++i) {
+                        carry += (unsigned long long)out[i] + n[i];
+                        out[i] = carry % base;
+                        carry /= base;
                     }
-                    quotient[j++] = q;
-                    //update t_pos and shift the remainder to the end of the array if there's any
-                    if (i == 0) t_pos = m;
-                    else if (i == m-t_pos) t_pos = 1;
-                    else {
-                        t_pos = m;
-                        for (int n = i-1; n >= 0; --n)
-                            temp[--t_pos] = t[n];
+                }
+            }
+            //a = a/2 mod N, N being odd
+            void half(std::vector<unsigned int>& a) {
+                unsigned long long carry = 0;
+                if (a[0] % 2) {
+                    for (int i = 0; i < k; ++i) {
+                        carry += (unsigned long long)a[i] + n[i];
+                        a[i] = carry % base;
+                        carry /= base;
                     }
                 }
+                for (int i = k-1; i >= 0; --i) {
+                    unsigned long long cur = carry * base + a[i];
+                    a[i] = (unsigned int)(cur / 2);
+                    carry = cur % 2;
+                }
             }
-        }
-        
-        BigInt divide(const BigInt& b, bool move = false) {
-            if (b.inUse == 1 && b.arr[0] == 0)
-                throw divisionByZero("Error In BigInt: divisionByZero check\n");
-            BigInt result;
-            result.isNeg = b.isNeg? !isNeg : isNeg;
-            
-            if (this->inUse < 19 && b.inUse < 19)
-                result.move((long long)*this / (long long)b);
-            
-            else if (b.inUse <= inUse) {
-                s_type quotient[inUse-b.inUse+1], temp[b.inUse+1];
-                int j = 0, m = b.inUse+1;
-                int t_pos = m;
-                divide_modulo_helper(b, quotient, temp, j, t_pos, m);
-                
-                if (j == 1) result.arr[0] = quotient[0];
-                else {
-                    int start = 0;
-                    if (quotient[0] == 0) ++start;
-                    result.allocated = j - start;
-                    result.inUse = result.allocated;
-                    delete [] result.arr;
-                    result.arr = new s_type [result.allocated];
-                    for (int i = j-1, n = 0; i >= start; --i)
-                        result.arr[n++] = quotient[i];
+            std::vector<unsigned int> to(const BigInt& x) {
+                BigInt y(x);
+                y.left_shift(9 * k);
+                y %= *N;
+                return toLimbs(y);
+            }
+        };
+        //Miller-Rabin with the bases in a Montgomery domain for odd n > 3 not divisible by 5
+        static bool millerRabin(Montgomery& mont, const std::vector<unsigned int>& base,
+                                const std::vector<unsigned char>& dBits, size_t dLen, int s,
+                                const std::vector<unsigned int>& one, const std::vector<unsigned int>& minusOne) {
+            std::vector<unsigned int> x = one, tmp;
+            for (size_t i = dLen; i > 0; --i) {
+                mont.mul(x, x, tmp); x.swap(tmp);
+                if ((dBits[(i-1)/8] >> ((i-1)%8)) & 1) {
+                    mont.mul(x, base, tmp); x.swap(tmp);
                 }
             }
-            if (move) this->move(std::forward<BigInt&&>(result));
-            return result;
+            if (x == one || x == minusOne)
+                return true;
+            for (int r = 1; r < s; ++r) {
+                mont.mul(x, x, tmp); x.swap(tmp);
+                if (x == minusOne)
+                    return true;
+                if (x == one)
+                    return false;
+            }
+            return false;
+        }
+        //strong Lucas probable prime test with Selfridge's parameters, for odd n > 3,
+        //computed in the Montgomery domain of n
+        static bool strongLucas(const BigInt& n, Montgomery& mont) {
+            long long D = 5;
+            for (int tries = 0; ; ++tries) {
+                int j = n.jacobi(D);
+                if (j == -1) break;
+                if (j == 0 && n.compare(D < 0? -D : D) != 0)
+                    return false;
+                if (tries == 10) {
+                    BigInt r = isqrt(n);
+                    if ((r * r).compare(n) == 0)
+                        return false;
+                }
+                D = (D > 0)? -(D + 2) : -D + 2;
+            }
+            //D and Q = (1-D)/4 reduced into [0, n)
+            BigInt Dn(n), Qn(n);
+            Dn.addSmall(D < 0? -D : D, D < 0);
+            long long Q = (1 - D) / 4;
+            if (Q < 0) Qn.addSmall(-Q, true);
+            else Qn.assignSmall(Q, false);
+
+            BigInt d(n);
+            d.addSmall(1, false);
+            int s = 0;
+            while (d.arr[0] % 2 == 0) {
+                d.divSmall(2);
+                ++s;
+            }
+            std::vector<unsigned char> bits;
+            d.toLittleEndian(bits);
+            size_t len = d.bit_length();
+            std::vector<unsigned int> U = mont.to(BigInt(1)), V = U, Dm = mont.to(Dn), Qm = mont.to(Qn),
+                Qk = Qm, t1, t2;
+            for (size_t i = len-1; i > 0; --i) {
+                //k -> 2k
+                mont.mul(U, V, t1); U.swap(t1);
+                mont.mul(V, V, t1); mont.sub(t1, Qk, t2); mont.sub(t2, Qk, V);
+                mont.mul(Qk, Qk, t1); Qk.swap(t1);
+                if ((bits[(i-1)/8] >> ((i-1)%8)) & 1) {
+                    //k -> k+1 with P = 1
+                    mont.add(U, V, t1);
+                    mont.mul(Dm, U, t2); mont.add(t2, V, U);
+                    mont.half(t1); mont.half(U);
+                    V.swap(U); U.swap(t1);
+                    mont.mul(Qk, Qm, t1); Qk.swap(t1);
+                }
+            }
+            std::vector<unsigned int> zero(mont.k, 0);
+            if (U == zero || V == zero)
+                return true;
+            for (int r = 1; r < s; ++r) {
+                mont.mul(V, V, t1); mont.sub(t1, Qk, t2); mont.sub(t2, Qk, V);
+                if (V == zero)
+                    return true;
+                mont.mul(Qk, Qk, t1); Qk.swap(t1);
+            }
+            return false;
+        }
+        #ifdef __SIZEOF_INT128__
+        static unsigned long long powMod64(unsigned long long a, unsigned long long e, unsigned long long m) {
+            unsigned long long r = 1;
+            a %= m;
+            for (; e; e >>= 1) {
+                if (e & 1) r = (unsigned __int128)r * a % m;
+                a = (unsigned __int128)a * a % m;
+            }
+            return r;
+        }
+        //deterministic Miller-Rabin for odd n < 2^64
+        static bool isPrime64(unsigned long long n) {
+            unsigned long long d = n - 1;
+            int s = 0;
+            while (d % 2 == 0) { d /= 2; ++s; }
+            static const unsigned long long bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+            for (int i = 0; i < 12; ++i) {
+                unsigned long long a = bases[i] % n;
+                if (a == 0) continue;
+                unsigned long long x = powMod64(a, d, n);
+                if (x == 1 || x == n-1) continue;
+                int r = 1;
+                for (; r < s; ++r) {
+                    x = (unsigned __int128)x * x % n;
+                    if (x == n-1) break;
+                }
+                if (r == s) return false;
+            }
+            return true;
         }
-        long long modulo1(long long modulus) {
-            if (modulus == 0)
-                throw divisionByZero("Error In BigInt: divisionByZero check\n");
-            long long res = 0;
-            if (inUse == 1) {
-                res = arr[0] % modulus;
-                if (res && isNeg) res = -res;
-            }
-            else if (modulus == 1) return 0;
-            else if (modulus == 2) return (isNeg? -arr[0] : arr[0]) % 2;
-            else if (inUse < 19)
-                res = (long long)*this % modulus;
-            //if modulus is too big (that is; bigger than (LLONG_MAX - 9)/10)
-            //convert BigInt and take the modulus
-            else if (modulus > 922337203685477579)
-                res = (long long)modulo3(BigInt(modulus));
-            else {
-                for (int i = inUse-1; i >= 0; --i)
-                    res = (res*10 + arr[i]) % modulus;
-                if (res && isNeg) res = -res;
+        #endif
+        //BPSW plus rounds extra Miller-Rabin rounds with random bases. The caller has already
+        //ruled out n < 65536 and factors below the trial division bound.
+        static bool bpsw(const BigInt& n, int rounds) {
+            #ifdef __SIZEOF_INT128__
+            unsigned long long small;
+            if (n.toMagnitude(small))
+                return isPrime64(small);
+            #endif
+            Montgomery mont(n);
+            BigInt d(n);
+            d.subMagnitude(1);
+            int s = 0;
+            while (d.arr[0] % 2 == 0) {
+                d.divSmall(2);
+                ++s;
             }
-            return res;
+            std::vector<unsigned char> dBits;
+            d.toLittleEndian(dBits);
+            size_t dLen = d.bit_length();
+            BigInt nm1(n);
+            nm1.subMagnitude(1);
+            std::vector<unsigned int> one = mont.to(BigInt(1)), minusOne = mont.to(nm1);
+            if (!millerRabin(mont, mont.to(BigInt(2)), dBits, dLen, s, one, minusOne))
+                return false;
+            if (!strongLucas(n, mont))
+                return false;
+            std::mt19937_64 gen(n.hash());
+            std::vector<unsigned char> bytes(n.inUse / 2 + 8);
+            BigInt range(n);
+            range.subMagnitude(3);
+            for (int i = 0; i < rounds; ++i) {
+                for (size_t j = 0; j < bytes.size(); ++j)
+                    bytes[j] = gen() & 0xFF;
+                BigInt a = fromLittleEndian(bytes.data(), bytes.size()) % range;
+                a.addSmall(2, false);
+                if (!millerRabin(mont, mont.to(a), dBits, dLen, s, one, minusOne))
+                    return false;
+            }
+            return true;
         }
-        BigInt& modulo2(long long modulus) {
-            if (modulus == 0)
-                throw divisionByZero("Error In BigInt: divisionByZero check\n");
-            if (inUse == 1) {
-                arr[0] %= modulus;
-                if (!arr[0]) isNeg = false;
-            }
-            else if (modulus == 1) this->reset();
-            else if (modulus == 2) {
-                s_type i = arr[0] % 2;
-                if (i == 0)
-                    this->reset();
-                else
-                    this->reset(1, isNeg);
+        /*--------------------------Floating point conversion helpers-------------------------*/
+        template<typename T>
+        T convert(std::false_type) const {
+            T result = 0;
+            for (int i = inUse-1; i >= 0; --i)
+                result = (result*10) + arr[i];
+            if (isNeg) result *= -1;
+            return result;
+        }
+        static void parseFloating(const char* s, float& f) {f = std::strtof(s, NULL);}
+        static void parseFloating(const char* s, double& f) {f = std::strtod(s, NULL);}
+        static void parseFloating(const char* s, long double& f) {f = std::strtold(s, NULL);}
+        //digits [from, inUse) followed by an exponent, e.g. "-12345e67"
+        std::string scientific(int from, bool roundUp) const {
+            std::string s;
+            if (isNeg) s += '-';
+            for (int i = inUse-1; i >= from; --i)
+                s += '0' + arr[i];
+            if (roundUp) {
+                int i = s.size() - 1;
+                for (; i >= 0 && s[i] == '9'; --i)
+                    s[i] = '0';
+                if (i < 0 || s[i] == '-') s.insert(i+1, "1");
+                else ++s[i];
             }
-            else if (inUse < 19)
-                this->move((long long)*this % modulus);
-            else if (modulus > 922337203685477579)
-                modulo3(BigInt(modulus), true);
-            else {
-                long long res = 0;
-                for (int i = inUse-1; i >= 0; --i)
-                    res = (res*10 + arr[i]) % modulus;
-                this->move(BigInt(res));
+            return s + "e" + std::to_string(from);
+        }
+        /* Correctly rounded conversion. Values below 2^64 are converted by the hardware. Otherwise
+         * the leading 40 digits D give the bounds D*10^r <= |this| < (D+1)*10^r; if both bounds
+         * round to the same value (the usual case) that is the answer. Only when a rounding
+         * boundary falls between them are all digits used.
+         */
+        template<typename T>
+        T convert(std::true_type) const {
+            unsigned long long m;
+            if (toMagnitude(m))
+                return isNeg? -(T)m : (T)m;
+            const int lead = 40;
+            T lo, hi;
+            if (inUse > lead) {
+                parseFloating(scientific(inUse - lead, false).c_str(), lo);
+                parseFloating(scientific(inUse - lead, true).c_str(), hi);
+                if (lo == hi)
+                    return lo;
             }
-            return *this;
+            parseFloating(scientific(0, false).c_str(), lo);
+            return lo;
+        }
+        //the leading 17 digits as a double, and the number of digits after them
+        double leadingDigits(int& rest) const {
+            int count = (inUse < 17)? inUse : 17;
+            double t = 0;
+            for (int i = inUse-1; i >= inUse - count; --i)
+                t = t * 10 + arr[i];
+            rest = inUse - count;
+            return t;
         }
-        BigInt modulo3(const BigInt& b, bool move = false) {
-            BigInt result;
-            bool done = false;
-            if (b.inUse == 1) {
-                if (b.arr[0] == 0)
-                    throw divisionByZero("Error In BigInt: divisionByZero check\n");
-                else if (b.arr[0] == 1)
-                    done = true;
-                else if (b.arr[0] == 2) {
-                    done = true;
-                    result.arr[0] = arr[0] % 2;
-                    if (result.arr[0]) result.isNeg = isNeg;
-                }   
-            }
-            if (!done) {
-                if (this->inUse < 19 && b.inUse < 19)
-                    result.move((long long)*this % (long long)b);
-                else if (b.inUse <= inUse) {
-                    s_type quotient[inUse-b.inUse+1], temp[b.inUse+1];
-                    int j = 0, m = b.inUse+1;
-                    int t_pos = m;
-                    divide_modulo_helper(b, quotient, temp, j, t_pos, m);
-
-                    if (t_pos != m) {
-                        delete [] result.arr;
-                        result.allocated = m - t_pos;
-                        result.arr = new s_type[allocated];
-                        result.inUse = 0;
-                        for (; t_pos < m; ++t_pos)
-                            result.arr[result.inUse++] = temp[t_pos];
-                        if (!result)
-                            result.isNeg = isNeg;
-                    }
-                }
+        //wyhash-style mixer: folds the 128-bit product of the two keyed inputs
+        static unsigned long long hashMix(unsigned long long a, unsigned long long b) {
+            a ^= 0xa0761d6478bd642fULL;
+            b ^= 0xe7037ed1a0b428dbULL;
+            #ifdef __SIZEOF_INT128__
+            unsigned __int128 r = (unsigned __int128)a * b;
+            return (unsigned long long)r ^ (unsigned long long)(r >> 64);
+            #else
+            unsigned long long a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+            unsigned long long lo = a_lo * b_lo, mid1 = a_hi * b_lo, mid2 = a_lo * b_hi, hi = a_hi * b_hi;
+            unsigned long long mid = (lo >> 32) + (mid1 & 0xFFFFFFFF) + (mid2 & 0xFFFFFFFF);
+            hi += (mid1 >> 32) + (mid2 >> 32) + (mid >> 32);
+            lo = (lo & 0xFFFFFFFF) | (mid << 32);
+            return lo ^ hi;
+            #endif
+        }
+        /*-------------------------Batch reduction helpers-----------------------------*/
+        //builds a non-negative number from per-digit column sums in one carry pass
+        static BigInt fromColumns(const std::vector<unsigned long long>& cols) {
+            BigInt result((int)cols.size() + 20, 0, false);
+            unsigned long long carry = 0;
+            size_t i = 0;
+            for (; i < cols.size(); ++i) {
+                carry += cols[i];
+                result.arr[i] = carry % 10;
+                carry /= 10;
             }
-            if (move) this->move(std::forward<BigInt&&>(result));
+            for (; carry; carry /= 10)
+                result.arr[i++] = carry % 10;
+            while (i > 1 && result.arr[i-1] == 0) --i;
+            result.inUse = (i == 0)? 1 : i;
+            std::fill_n(result.arr+i, result.allocated-i, 0);
             return result;
         }
+        //balanced product tree over p[lo, hi). The left subtree runs on its own thread while
+        //threads > 1 and the operands are large enough to be worth it.
+        static BigInt productRange(const BigInt* const* p, size_t lo, size_t hi, int threads) {
+            if (hi - lo == 1)
+                return *p[lo];
+            if (hi - lo == 2)
+                return BigInt(*p[lo]).multiply(*p[lo+1]);
+            size_t mid = lo + (hi - lo) / 2;
+            size_t digits = 0, fork = tuning().parallelProduct;
+            for (size_t i = lo; i < hi && digits < fork; ++i)
+                digits += p[i]->inUse;
+            BigInt left, right;
+            if (threads > 1 && digits >= fork) {
+                std::future<BigInt> f = std::async(std::launch::async, productRange, p, lo, mid, threads/2);
+                right = productRange(p, mid, hi, threads - threads/2);
+                left = f.get();
+            }
+            else {
+                left = productRange(p, lo, mid, 1);
+                right = productRange(p, mid, hi, 1);
+            }
+            return left.multiply(right);
+        }
         //Used in left and right shift operators for multiplying or dividing by 2^63
         BigInt& get_shift63() {
             static BigInt shift63("9223372036854775808"); //same value as 2^63
@@ -508,14 +1615,6 @@ namespace my {
             }
             c.push_back(x);
         }
-        void bitStringHelper(BigInt& b, std::string& s, int count = 0) {
-            bool x = b % 2;
-            if (b.inUse > 1 || b.arr[0] > 1) {
-                b /= 2;
-                bitStringHelper(b, s);
-            }
-            s.push_back('0'+x);
-        }
         std::string to_words_helper(s_type* arr, int end, bool& isNeg) {
             std::string s;
             if (isNeg) {
@@ -576,7 +1675,19 @@ namespace my {
             inUse = x;
             arr = new s_type[allocated];
         }
+        friend class BigIntView;
+        friend class RnsInt;
         public:
+        /* Binary format (version 1), all multi-byte fields little-endian:
+         * byte 0     : format version
+         * byte 1     : flags (bit 0 set if negative)
+         * bytes 2-5  : number of digits
+         * bytes 6... : digits packed two per byte, least significant digit first,
+         *              low nibble first. An odd count leaves the last high nibble zero.
+         */
+        static const unsigned char serial_version = 1;
+        static const size_t serial_header = 6;
+
         BigInt() {
             arr = NULL; reset();
         }
@@ -595,32 +1706,35 @@ namespace my {
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         BigInt(T n) {
-            if (n < 0) {
-                isNeg = true;  n = -n;
-            }
-            else
-                isNeg = false;
-            allocated = numLength(n);
+            unsigned long long m;
+            splitSmall(n, m, isNeg);
+            allocated = 0;
+            for (unsigned long long t = m; allocated == 0 || t; t /= 10) ++allocated;
             arr = new s_type[allocated];
-            inUse = 0;
-            arr[inUse++] = n % 10;
-            while (n >= 10) {
-                n /= 10;
-                arr[inUse++] = n % 10;
-            }
+            for (inUse = 0; inUse < allocated; ++inUse, m /= 10)
+                arr[inUse] = m % 10;
         }
+        //Truncates toward zero. The mantissa is read straight from the IEEE-754 representation
+        //and scaled by the binary exponent, so the result is exact.
+        //Throws invalidArgument for infinity and NaN.
         BigInt(long double n) {
-            if (n < 0) {
-                isNeg = true;  n = -n;
+            arr = NULL; reset();
+            if (n != n || n - n != 0)
+                throw invalidArgument("In BigInt(long double). Value is not finite.");
+            int e;
+            long double m = std::frexp(n < 0? -n : n, &e);    //|n| = m * 2^e, 0.5 <= m < 1
+            //take the integer part of the mantissa 32 bits at a time
+            for (; e > 0 && m != 0; ) {
+                int take = (e < 32)? e : 32;
+                m = std::ldexp(m, take);
+                unsigned long long chunk = (unsigned long long)m;
+                m -= chunk;
+                mulAddSmall(1ULL << take, chunk);
+                e -= take;
             }
-            else
-                isNeg = false;
-            std::string s = std::to_string(n);
-            int index = s.find_last_of('.');
-            allocated = index;
-            arr = new s_type[allocated];
-            for (inUse = 0, --index; inUse < allocated; ++inUse, --index)
-                arr[inUse] = s[index] - '0';
+            if (e > 0 && !isZero())
+                multiply(powerOfTwo(e), true);
+            isNeg = n < 0 && !isZero();
         }
         BigInt(const char* s): BigInt() {
             if (s != NULL) {
@@ -640,6 +1754,9 @@ namespace my {
                 } 
             }
         }
+        explicit BigInt(const BigIntView& v);
+        //a view of the digits, valid until this number is next modified
+        BigIntView view() const;
         BigInt(const BigInt& b) {
             allocated = b.inUse;
             inUse = b.inUse;
@@ -666,11 +1783,7 @@ namespace my {
             typename = typename std::enable_if<std::is_integral<T>::value ||
             std::is_floating_point<T>::value>::type>
         explicit operator T() const {
-            T result = 0;
-            for (int i = inUse-1; i >= 0; --i)
-                result = (result*10) + arr[i];
-            if (isNeg) result *= -1;
-            return result;
+            return convert<T>(std::is_floating_point<T>());
         }
         template<bool> explicit operator bool() const {
             return (inUse > 1 || arr[0] > 0);
@@ -731,6 +1844,8 @@ namespace my {
             return result;
         }
         BigInt& operator+=(const BigInt& b) {
+            if (addNative(*this, b, false))
+                return *this;
             if (isNeg != b.isNeg)
                 subtract(b, true);
             else
@@ -757,6 +1872,8 @@ namespace my {
             BigInt temp = *this; ++*this; return temp;
         }
         BigInt& operator-=(const BigInt& b) {
+            if (addNative(*this, b, true))
+                return *this;
             if (isNeg != b.isNeg)
                 add(b, true);
             else
@@ -789,39 +1906,110 @@ namespace my {
             multiply(b, true);
             return *this;
         }
-        BigInt operator*(long b) {
-            return multiply(b);
+        BigInt operator/(const BigInt& b) {
+            return divide(b);
         }
-        BigInt& operator*=(long b) {
-            multiply(b, true);
+        BigInt& operator/=(const BigInt& b) {
+            divide(b, true);
             return *this;
         }
-        BigInt operator/(long b) {
-            return divide(b);
+        BigInt operator%(const BigInt& b) {
+            return modulo3(b);
         }
-        BigInt& operator/=(long b) {
-            divide(b, true);
+        BigInt& operator%=(const BigInt& b) {
+            modulo3(b, true);
             return *this;
         }
-        BigInt operator/(const BigInt& b) {
-            return divide(b);
+        /*---------------Arithmetic with built-in integers. None of these allocate a temporary----------*/
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt& operator+=(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            addSmall(m, neg);
+            return *this;
         }
-        BigInt& operator/=(const BigInt& b) {
-            divide(b, true);
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt operator+(T t) {
+            BigInt result(*this);
+            result += t;
+            return result;
+        }
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt& operator-=(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            addSmall(m, !neg);
             return *this;
         }
-        BigInt operator%(const BigInt& b) {
-            return modulo3(b);
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt operator-(T t) {
+            BigInt result(*this);
+            result -= t;
+            return result;
         }
-        BigInt& operator%=(const BigInt& b) {
-            modulo3(b, true);
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt& operator*=(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            mulSmall(m, neg);
             return *this;
         }
-        long long operator%(long long b) {
-            return modulo1(b);
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt operator*(T t) {
+            BigInt result(*this);
+            result *= t;
+            return result;
+        }
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt& operator/=(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            divSmallSigned(m, neg);
+            return *this;
         }
-        BigInt& operator%=(long long b) {
-            return modulo2(b);
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt operator/(T t) {
+            BigInt result(*this);
+            result /= t;
+            return result;
+        }
+        //the remainder has the sign of this
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        BigInt& operator%=(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            if (m == 0)
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            assignSmall(modSmall(m), isNeg);
+            return *this;
+        }
+        //returns a long long when every remainder fits in one, that is, unless T is an
+        //unsigned 64-bit type
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && (std::is_signed<T>::value ||
+            sizeof(T) < sizeof(long long)), long long>::type operator%(T t) {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            if (m == 0)
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            long long r = (long long)modSmall(m);
+            return isNeg? -r : r;
+        }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value &&
+            sizeof(T) >= sizeof(long long), BigInt>::type operator%(T t) {
+            BigInt result(*this);
+            result %= t;
+            return result;
         }
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value ||
@@ -833,7 +2021,9 @@ namespace my {
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend BigInt operator+(T t, const BigInt& b) {
-            return BigInt(t) + b;
+            BigInt result(b);
+            result += t;
+            return result;
         }
         friend long double operator+(long double d, const BigInt& b) {
             return d + (long double) b;
@@ -848,7 +2038,10 @@ namespace my {
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend BigInt operator-(T t, const BigInt& b) {
-            return BigInt(t) - b;
+            BigInt result(b);
+            result -= t;
+            result.negate();
+            return result;
         }
         friend long double operator-(long double d, const BigInt& b) {
             return d - (long double) b;
@@ -863,26 +2056,31 @@ namespace my {
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend BigInt operator*(T t, const BigInt& b) {
-            return BigInt(t) * b;
+            BigInt result(b);
+            result *= t;
+            return result;
         }
         friend long double operator*(long double d, const BigInt& b) {
-            return d + (long double) b;
+            return d * (long double) b;
         }
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value ||
                 std::is_floating_point<T>::value>::type>
         friend T& operator/=(T& t, const BigInt& b) {
-            t += (T)b;
+            t = t / b;
             return t;
         }
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend T operator/(T t, const BigInt& b) {
-            if (b.inUse < 19)
-                return t / (T)b;
-            else if (t > 999999999999999999)
-                return (T) (BigInt(t) / b);
-            return 0;
+            if (b.isZero())
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            unsigned long long m, d; bool neg;
+            splitSmall(t, m, neg);
+            if (!b.toMagnitude(d) || d > m)
+                return 0;
+            unsigned long long q = m / d;
+            return (neg != b.isNeg)? (T)(0ULL - q) : (T)q;
         }
         friend long double operator/(long double d, const BigInt& b) {
             return d / (long double) b;
@@ -890,27 +2088,26 @@ namespace my {
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend T& operator%=(T& t, const BigInt& b) {
-            if (b.inUse < 19)
-                t %= (T)b;
-            else if (t > 999999999999999999) {   //if t has 19 digits
-                t = (T) (BigInt(t) % b);
-            }
+            t = t % b;
             return t;
         }
         template <typename T,
             typename = typename std::enable_if<std::is_integral<T>::value>::type>
         friend T operator%(T t, const BigInt& b) {
-            if (b.inUse < 19)
-                return t % (T)b;
-            else if (t > 999999999999999999) {
-                return (T) (BigInt(t) % b);
-            }
-            return t;
+            if (b.isZero())
+                throw divisionByZero("Error In BigInt: divisionByZero check\n");
+            unsigned long long m, d; bool neg;
+            splitSmall(t, m, neg);
+            if (!b.toMagnitude(d) || d > m)
+                return t;
+            unsigned long long r = m % d;
+            return neg? (T)(0ULL - r) : (T)r;
         }
         BigInt& operator=(const BigInt& b) {
             if (this != &b) {
                 delete [] arr;
                 inUse = b.inUse;
+                isNeg = b.isNeg;
                 allocated = b.inUse;
                 arr = new s_type[allocated];
                 for (int i = 0; i < inUse; ++i)
@@ -918,12 +2115,16 @@ namespace my {
             }
             return *this;
         }
-        BigInt operator-() {
+        BigInt operator-() const & {
             BigInt result = *this;
             if (result)
                 result.isNeg = !isNeg;
             return result;
         }
+        //negating a temporary reuses its digits
+        BigInt operator-() && {
+            return std::move(negate());
+        }
         BigInt& negate() {
             if (*this)
                 isNeg = !isNeg;
@@ -946,11 +2147,199 @@ namespace my {
             bitsHelper(temp, c);
         }
         std::string to_bit_string() {
-            std::string res;
-            res.reserve(inUse*2);
-            BigInt temp = *this;
-            bitStringHelper(temp, res);
-            return res;
+            return toPowerOfTwoBase(1);
+        }
+        size_t serialized_size() const {
+            return serial_header + (inUse + 1) / 2;
+        }
+        //writes the binary form into buffer and returns the number of bytes used.
+        //Throws indexOutOfRange if size is smaller than serialized_size().
+        size_t serialize(unsigned char* buffer, size_t size) const {
+            size_t n = serialized_size();
+            if (size < n)
+                throw indexOutOfRange("In BigInt::serialize. Buffer is too small.");
+            unsigned int count = inUse;
+            buffer[0] = serial_version;
+            buffer[1] = isNeg? 1 : 0;
+            for (int i = 0; i < 4; ++i)
+                buffer[2+i] = (count >> (8*i)) & 0xFF;
+            unsigned char* out = buffer + serial_header;
+            int i = 0;
+            for (; i+1 < inUse; i += 2)
+                *out++ = arr[i] | (arr[i+1] << 4);
+            if (i < inUse)
+                *out = arr[i];
+            return n;
+        }
+        //appends the binary form to the end of buffer.
+        void serialize(std::vector<unsigned char>& buffer) const {
+            size_t pos = buffer.size();
+            buffer.resize(pos + serialized_size());
+            serialize(buffer.data() + pos, buffer.size() - pos);
+        }
+        static BigInt deserialize(const unsigned char* data, size_t size);
+
+        /* Word import and export in the style of mpz_import/mpz_export. Only the magnitude is
+         * converted; the sign is ignored on export and the result of an import is non-negative.
+         * order  : 1 for most significant word first, -1 for least significant word first.
+         * endian : 1 for big-endian words, -1 for little-endian, 0 for the host's byte order.
+         * Both throw invalidArgument if size is 0 or order or endian is out of range.
+         */
+        static BigInt import_words(const void* data, size_t count, size_t size, int order, int endian) {
+            checkWordFormat(size, order, endian, "In BigInt::import_words. Invalid word format.");
+            const unsigned char* in = (const unsigned char*)data;
+            bool bigWords = (endian == 1) || (endian == 0 && !nativeLittleEndian());
+            std::vector<unsigned char> b(count * size);
+            for (size_t w = 0; w < count; ++w) {
+                size_t word = (order == 1)? count-1-w : w;
+                for (size_t j = 0; j < size; ++j)
+                    b[w*size + j] = in[word*size + (bigWords? size-1-j : j)];
+            }
+            return fromLittleEndian(b.data(), b.size());
+        }
+        //returns count*size bytes, where count is the fewest words that hold the magnitude
+        std::vector<unsigned char> export_words(size_t size, int order, int endian) const {
+            checkWordFormat(size, order, endian, "In BigInt::export_words. Invalid word format.");
+            std::vector<unsigned char> b;
+            toLittleEndian(b);
+            bool bigWords = (endian == 1) || (endian == 0 && !nativeLittleEndian());
+            size_t count = (b.size() + size - 1) / size;
+            std::vector<unsigned char> out(count * size, 0);
+            for (size_t w = 0; w < count; ++w) {
+                size_t word = (order == 1)? count-1-w : w;
+                for (size_t j = 0; j < size && w*size + j < b.size(); ++j)
+                    out[word*size + (bigWords? size-1-j : j)] = b[w*size + j];
+            }
+            return out;
+        }
+        static BigInt from_bytes(const unsigned char* data, size_t n, bool bigEndian = true) {
+            return import_words(data, n, 1, bigEndian? 1 : -1, 0);
+        }
+        //zero gives an empty vector
+        std::vector<unsigned char> to_bytes(bool bigEndian = true) const {
+            return export_words(1, bigEndian? 1 : -1, 0);
+        }
+        /* Algorithm thresholds. They apply to the whole process and can be changed at any time.
+         * A profile is a text file of "name value" lines, e.g. "karatsuba 48".
+         */
+        static BigIntThresholds get_thresholds() {
+            BigIntThresholds t;
+            t.karatsuba = tuning().karatsuba;
+            t.parallel_product = tuning().parallelProduct;
+            return t;
+        }
+        //Throws invalidArgument if karatsuba < 2 or parallel_product < 1.
+        static void set_thresholds(const BigIntThresholds& t) {
+            if (!validThresholds(t))
+                throw invalidArgument("In BigInt::set_thresholds. Threshold out of range.");
+            tuning().karatsuba = t.karatsuba;
+            tuning().parallelProduct = t.parallel_product;
+        }
+        //Returns false, leaving the thresholds unchanged, if the file cannot be read or is invalid.
+        static bool load_thresholds(const char* path) {
+            BigIntThresholds t = get_thresholds();
+            if (!parseProfile(path, t) || !validThresholds(t))
+                return false;
+            set_thresholds(t);
+            return true;
+        }
+        static bool save_thresholds(const char* path) {
+            std::ofstream out(path);
+            BigIntThresholds t = get_thresholds();
+            out << "karatsuba " << t.karatsuba << "\n";
+            out << "parallel_product " << t.parallel_product << "\n";
+            return (bool)out;
+        }
+        /* Benchmarks each tier boundary on this machine, sets the fastest thresholds and returns
+         * them. Takes well under a second. Save the result with save_thresholds and point
+         * BIGINT_TUNING_PROFILE at the file to use it in later runs.
+         */
+        static BigIntThresholds tune_thresholds() {
+            BigIntThresholds best = get_thresholds();
+            std::mt19937_64 gen(1);
+            std::vector<BigInt> ops;
+            const int sizes[] = {200, 600, 2000};
+            for (int i = 0; i < 3; ++i) {
+                ops.push_back(randomDigits(sizes[i], gen));
+                ops.push_back(randomDigits(sizes[i], gen));
+            }
+            const int cutoffs[] = {16, 24, 32, 48, 64, 96, 128, 192, 256};
+            double bestTime = 1e300;
+            for (int c = 0; c < 9; ++c) {
+                tuning().karatsuba = cutoffs[c];
+                double t = timeBest([&ops] {
+                    for (int r = 0; r < 4; ++r)
+                        for (size_t i = 0; i < ops.size(); i += 2)
+                            ops[i].multiply(ops[i+1]);
+                });
+                if (t < bestTime) {
+                    bestTime = t;
+                    best.karatsuba = cutoffs[c];
+                }
+            }
+            tuning().karatsuba = best.karatsuba;
+
+            int threads = (int)std::thread::hardware_concurrency();
+            if (threads > 1) {
+                std::vector<BigInt> factors;
+                std::vector<const BigInt*> p;
+                for (int i = 0; i < 256; ++i)
+                    factors.push_back(randomDigits(100, gen));
+                for (size_t i = 0; i < factors.size(); ++i)
+                    p.push_back(&factors[i]);
+                const int forks[] = {1024, 2048, 4096, 8192, 16384, 32768};
+                bestTime = 1e300;
+                for (int c = 0; c < 6; ++c) {
+                    tuning().parallelProduct = forks[c];
+                    double t = timeBest([&p, threads] {productRange(p.data(), 0, p.size(), threads);});
+                    if (t < bestTime) {
+                        bestTime = t;
+                        best.parallel_product = forks[c];
+                    }
+                }
+            }
+            set_thresholds(best);
+            return best;
+        }
+        /* Text in bases 2 to 36: an optional sign followed by digits 0-9 and letters a-z in
+         * either case, with no prefix. Power-of-two bases are packed to and from the binary
+         * form directly; other bases are converted 18 decimal digits' worth at a time, which
+         * is quadratic. from_string first splits long input into halves joined by Karatsuba
+         * products, so it is subquadratic.
+         * Throws invalidArgument for a bad base and invalidFormat for a malformed string.
+         */
+        static BigInt from_string(const std::string& str, int base = 10) {
+            checkBase(base, "In BigInt::from_string. Base must be between 2 and 36.");
+            const char* begin = str.c_str();
+            const char* end = begin + str.size();
+            bool neg = false;
+            if (begin != end && (*begin == '-' || *begin == '+'))
+                neg = *begin++ == '-';
+            if (begin == end)
+                throw invalidFormat("In BigInt::from_string. No digits.");
+            for (const char* c = begin; c != end; ++c)
+                if (radixDigit(*c) >= base)
+                    throw invalidFormat("In BigInt::from_string. Invalid digit.");
+            while (end - begin > 1 && *begin == '0')
+                ++begin;
+            BigInt result;
+            if (base == 10)
+                result = BigInt(begin);
+            else if (int k = log2Base(base))
+                result = fromPowerOfTwoBase(begin, end, k);
+            else
+                result = fromOtherBase(begin, end, base);
+            result.isNeg = neg && !result.isZero();
+            return result;
+        }
+        friend std::string to_string(const BigInt& b, int base) {
+            checkBase(base, "In to_string. Base must be between 2 and 36.");
+            std::string s = b.isNeg? "-" : "";
+            if (base == 10)
+                return (std::string)b;
+            else if (int k = log2Base(base))
+                return s + b.toPowerOfTwoBase(k);
+            return s + b.toOtherBase(base);
         }
         BigInt& left_shift (unsigned int n) {
             if (inUse > 1 || arr[0] > 0) {
@@ -991,8 +2380,111 @@ namespace my {
             int c = compare_help(arr, inUse, b.arr, b.inUse);
             return (isNeg && b.isNeg)? -c : c;
         }
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        int compare(T t) const {
+            unsigned long long m; bool neg;
+            splitSmall(t, m, neg);
+            return compareSmall(m, neg);
+        }
         size_t length() const {return inUse;}
         size_t capacity() const {return allocated;}
+        bool is_negative() const {return isNeg;}
+
+        /*--------------Bitwise operators on the infinite two's complement form-------------*/
+        BigInt operator&(const BigInt& b) {
+            return bitwise(b, '&');
+        }
+        BigInt& operator&=(const BigInt& b) {
+            this->move(bitwise(b, '&'));
+            return *this;
+        }
+        BigInt operator|(const BigInt& b) {
+            return bitwise(b, '|');
+        }
+        BigInt& operator|=(const BigInt& b) {
+            this->move(bitwise(b, '|'));
+            return *this;
+        }
+        BigInt operator^(const BigInt& b) {
+            return bitwise(b, '^');
+        }
+        BigInt& operator^=(const BigInt& b) {
+            this->move(bitwise(b, '^'));
+            return *this;
+        }
+        //~x == -x - 1
+        BigInt operator~() const {
+            BigInt result(*this);
+            result.isNeg = !result.isNeg;
+            result.addSmall(1, true);
+            return result;
+        }
+        //number of bits in the magnitude; 0 for zero
+        size_t bit_length() const {
+            std::vector<unsigned char> b;
+            toLittleEndian(b);
+            if (b.empty())
+                return 0;
+            size_t n = 8 * (b.size() - 1);
+            for (unsigned char c = b.back(); c; c >>= 1) ++n;
+            return n;
+        }
+        //Negative numbers have infinitely many set bits, so popcount returns the largest
+        //size_t for them, as mpz_popcount does.
+        size_t popcount() const {
+            if (isNeg && !isZero())
+                return (size_t)-1;
+            std::vector<unsigned char> b;
+            toLittleEndian(b);
+            return popcountBytes(b);
+        }
+        /* Bit i only depends on the value modulo 2^(i+1), which divides 10^(i+1), so only the
+         * lowest i+1 digits are converted. Low bits of a long number are cheap; bits near the
+         * top still convert the whole number, so use to_bytes() for bulk bit work.
+         */
+        bool test_bit(size_t i) const {
+            int k = (i < (size_t)inUse)? (int)i + 1 : inUse;
+            BigInt low(k, k, false);
+            std::copy(arr, arr + k, low.arr);
+            while (low.inUse > 1 && low.arr[low.inUse-1] == 0) --low.inUse;
+            std::vector<unsigned char> b;
+            low.toLittleEndian(b);
+            //the low digits are zero, so the value is a multiple of 2^(i+1) whatever its sign
+            if (b.empty())
+                return false;
+            //bits above the magnitude are all 0, or all 1 for a negative number
+            if (i/8 >= b.size())
+                return isNeg && !isZero();
+            if (isNeg && !isZero())
+                negateBytes(b);
+            return (b[i/8] >> (i%8)) & 1;
+        }
+        //Setting a clear bit adds 2^i and clearing a set one subtracts it, for either sign.
+        BigInt& set_bit(size_t i) {
+            if (!test_bit(i))
+                *this += powerOfTwo(i);
+            return *this;
+        }
+        BigInt& clear_bit(size_t i) {
+            if (test_bit(i))
+                *this -= powerOfTwo(i);
+            return *this;
+        }
+        BigInt& flip_bit(size_t i) {
+            if (test_bit(i))
+                *this -= powerOfTwo(i);
+            else
+                *this += powerOfTwo(i);
+            return *this;
+        }
+        //Number of differing bits. The largest size_t if the signs differ, as in mpz_hamdist.
+        friend size_t hamming_distance(const BigInt& a, const BigInt& b) {
+            return a.bitwise(b, '^').popcount();
+        }
+
+        //Depends only on the value. Computed by BigIntView::hash().
+        size_t hash() const;
 
         void shrink_to_fit() {
             allocated = inUse;
@@ -1023,6 +2515,181 @@ namespace my {
             result.isNeg = false;
             return result;
         }
+        friend BigInt abs(BigInt&& b) {
+            b.isNeg = false;
+            return std::move(b);
+        }
+        /* Quotient a / b for b known to divide a. The factors 2 and 5 of b are divided out of
+         * both numbers with word-sized steps; the rest is coprime to 10 and is handled by Hensel
+         * division, which needs neither quotient estimation nor the remainder. If b does not
+         * divide a the result is meaningless. Throws divisionByZero if b is zero.
+         */
+        friend BigInt divexact(const BigInt& a, const BigInt& b) {
+            if (b.isZero())
+                throw divisionByZero("In divexact. Division by zero.");
+            bool neg = a.isNeg != b.isNeg;
+            BigInt x = a, c = b;
+            x.isNeg = c.isNeg = false;
+            unsigned long long m;
+            if (c.toMagnitude(m) && m <= 1000000000000000000ULL)
+                x.divSmall(m);
+            else {
+                int t = c.trailingZeros();
+                c.right_shift(t);
+                x.right_shift(t);
+                x.divPower(2, c.stripFactor(2));
+                x.divPower(5, c.stripFactor(5));
+                if (!(c.inUse == 1 && c.arr[0] == 1))
+                    x.hensel(c, &x);
+            }
+            x.isNeg = neg && !x.isZero();
+            return x;
+        }
+        //whether b divides a, without computing the quotient. Zero only divides zero.
+        friend bool divisible_by(const BigInt& a, const BigInt& b) {
+            if (b.isZero())
+                return a.isZero();
+            unsigned long long m;
+            if (b.toMagnitude(m))
+                return a.modSmall(m) == 0;
+            int t = b.trailingZeros();
+            if (!divisible_by_10exp(a, t))
+                return false;
+            BigInt x = a, c = b;
+            x.isNeg = c.isNeg = false;
+            c.right_shift(t);
+            x.right_shift(t);
+            if (!x.divisibleByPower(2, c.stripFactor(2)) || !x.divisibleByPower(5, c.stripFactor(5)))
+                return false;
+            return (c.inUse == 1 && c.arr[0] == 1) || x.hensel(c, NULL);
+        }
+        //whether 2^k divides a. Looks only at the last k digits.
+        friend bool divisible_by_2exp(const BigInt& a, unsigned long long k) {
+            return a.divisibleByPower(2, k);
+        }
+        //whether 10^k divides a: the last k digits are zero
+        friend bool divisible_by_10exp(const BigInt& a, unsigned long long k) {
+            if (a.isZero() || k == 0)
+                return true;
+            if (k >= (unsigned long long)a.inUse)
+                return false;
+            for (unsigned long long i = 0; i < k; ++i)
+                if (a.arr[i]) return false;
+            return true;
+        }
+        //floor of the square root by Newton's method. Throws invalidArgument for negative n.
+        friend BigInt isqrt(const BigInt& n) {
+            if (n.isNeg && !n.isZero())
+                throw invalidArgument("In BigInt::isqrt. Negative argument.");
+            if (n.inUse == 1)
+                return BigInt(n.arr[0] >= 9? 3 : n.arr[0] >= 4? 2 : n.arr[0] >= 1? 1 : 0);
+            BigInt x(1, 1);
+            x.left_shift((n.inUse + 1) / 2);
+            BigInt nn(n);
+            while (true) {
+                BigInt y = nn / x;
+                y += x;
+                y.divSmall(2);
+                if (y.compare(x) >= 0)
+                    return x;
+                x.move(std::move(y));
+            }
+        }
+        /* BPSW probable prime test: trial division by the primes below 2000, a Miller-Rabin test
+         * to base 2 in Montgomery form and a strong Lucas test, followed by rounds Miller-Rabin
+         * rounds with random bases. No BPSW pseudoprime is known. Numbers below 2^64 are tested
+         * deterministically.
+         */
+        friend bool is_probable_prime(const BigInt& n, int rounds = 2) {
+            if (n.isNeg || n.compare(2) < 0)
+                return false;
+            unsigned long long small;
+            if (n.toMagnitude(small) && small < 65536) {
+                if (small < 4) return true;
+                if (small % 2 == 0) return false;
+                const std::vector<unsigned int>& primes = smallPrimes();
+                return std::binary_search(primes.begin(), primes.end(), (unsigned int)small);
+            }
+            if (n.arr[0] % 2 == 0 || n.arr[0] == 5)
+                return false;
+            std::vector<unsigned int> res;
+            n.smallResidues(302, res);  //the odd primes below 2000
+            for (size_t i = 0; i < res.size(); ++i) {
+                if (res[i] == 0)
+                    return false;
+            }
+            return bpsw(n, rounds);
+        }
+        //smallest prime greater than n. Candidates are sieved in windows by the primes below 65536.
+        friend BigInt next_prime(const BigInt& n) {
+            if (n.compare(2) < 0)
+                return BigInt(2);
+            BigInt c(n);
+            c.addSmall(1, false);
+            if (c.compare(65536) < 0) {
+                while (!is_probable_prime(c))
+                    c.addSmall(1, false);
+                return c;
+            }
+            if (c.arr[0] % 2 == 0)
+                c.addSmall(1, false);
+            const std::vector<unsigned int>& primes = smallPrimes();
+            const size_t window = 4096;     //candidates c, c+2, ..., c+2*(window-1)
+            std::vector<unsigned int> res;
+            std::vector<bool> composite(window);
+            while (true) {
+                c.smallResidues(primes.size(), res);
+                std::fill(composite.begin(), composite.end(), false);
+                for (size_t i = 0; i < primes.size(); ++i) {
+                    unsigned long long p = primes[i];
+                    //first j with c + 2j divisible by p
+                    unsigned long long j = (p - res[i]) % p * ((p + 1) / 2) % p;
+                    for (; j < window; j += p)
+                        composite[j] = true;
+                }
+                for (size_t j = 0; j < window; ++j) {
+                    if (composite[j]) continue;
+                    BigInt candidate(c);
+                    candidate.addSmall(2 * j, false);
+                    if (bpsw(candidate, 2))
+                        return candidate;
+                }
+                c.addSmall(2 * window, false);
+            }
+        }
+        //Like std::frexp: returns m with 0.5 <= |m| < 1 and sets exp so that b == m * 2^exp.
+        //Exact when b is within the range of double, otherwise good to about 15 digits.
+        friend double frexp(const BigInt& b, long long* exp) {
+            int e = 0;
+            if (b.inUse <= 300) {
+                double m = std::frexp((double)b, &e);
+                *exp = e;
+                return m;
+            }
+            int rest;
+            double t = b.leadingDigits(rest);
+            double l2 = rest * 3.321928094887362347870319;  //log2(10)
+            double whole = std::floor(l2);
+            double m = std::frexp(t * std::exp2(l2 - whole), &e);
+            *exp = e + (long long)whole;
+            return b.isNeg? -m : m;
+        }
+        //log10 and log2 estimates from the leading digits, without a full conversion.
+        //Like the std versions they return -infinity for zero and NaN for negative numbers.
+        friend double log10(const BigInt& b) {
+            if (b.isZero() || b.isNeg)
+                return std::log10(b.isZero()? 0.0 : -1.0);
+            int rest;
+            double t = b.leadingDigits(rest);
+            return std::log10(t) + rest;
+        }
+        friend double log2(const BigInt& b) {
+            if (b.isZero() || b.isNeg)
+                return std::log2(b.isZero()? 0.0 : -1.0);
+            int rest;
+            double t = b.leadingDigits(rest);
+            return std::log2(t) + rest * 3.321928094887362347870319;
+        }
         friend BigInt pow(BigInt x, unsigned int y) {
             BigInt res(1,1);
 
@@ -1035,11 +2702,392 @@ namespace my {
             } 
             return res;
         }
+        /*---------------------------Cancellable operations------------------------------
+         * These check token before every step and throw operationCancelled once it has been
+         * cancelled. progress, if set, is called on the computing thread as steps complete.
+         */
+        //The multiplies are cancellable themselves, so a large squaring can be stopped midway.
+        //Progress is weighted by Karatsuba cost: at step t x has grown 2^t times, so squaring it
+        //costs about 3^t, and multiplying it into a result f times its length about 3^t * f^0.585.
+        friend BigInt pow(BigInt x, unsigned int y, const CancellationToken& token,
+            const ProgressCallback& progress = ProgressCallback()) {
+            std::vector<double> mulCost, sqrCost;
+            double total = 0, scale = 1;
+            for (unsigned int t = y, low = 0, bit = 1; t > 0; t >>= 1, bit <<= 1, scale *= 3) {
+                mulCost.push_back((t % 2 == 1)? scale * std::pow((double)low / bit, 0.585) : 0);
+                sqrCost.push_back((t > 1)? scale : 0);
+                total += mulCost.back() + sqrCost.back();
+                if (t % 2 == 1) low += bit;
+            }
+            if (total == 0) total = 1;
+            BigInt res(1,1);
+            double done = 0;
+            ProgressCallback first, second;
+            for (int step = 0; y > 0; y >>= 1, ++step) {
+                token.throw_if_cancelled();
+                if (progress) {
+                    progress(done / total);
+                    double lo = done / total, m = mulCost[step] / total, q = sqrCost[step] / total;
+                    first = [&progress, lo, m](double p) {progress(lo + m * p);};
+                    second = [&progress, lo, m, q](double p) {progress(lo + m + q * p);};
+                }
+                if (y % 2 == 1)
+                    res = multiplyCancellable(res, x, token, first);
+                if (y > 1)
+                    x = multiplyCancellable(x, x, token, second);
+                done += mulCost[step] + sqrCost[step];
+            }
+            if (progress) progress(1.0);
+            return res;
+        }
+        //Same algorithms as operator*. The Karatsuba tier checks token at every split and reports
+        //progress; products below the threshold are short enough to run without checks.
+        friend BigInt multiply(const BigInt& a, const BigInt& b, const CancellationToken& token,
+            const ProgressCallback& progress = ProgressCallback()) {
+            return multiplyCancellable(a, b, token, progress);
+        }
+        /*------------------------------Batch reductions---------------------------------*/
+        //Sums all numbers with one pass over their digits and a single carry pass at the end.
+        template<typename Iter>
+        friend BigInt sum(Iter first, Iter last) {
+            std::vector<unsigned long long> pos, neg;
+            for (; first != last; ++first) {
+                const BigInt& b = *first;
+                std::vector<unsigned long long>& cols = b.isNeg? neg : pos;
+                if (cols.size() < (size_t)b.inUse)
+                    cols.resize(b.inUse, 0);
+                for (int i = 0; i < b.inUse; ++i)
+                    cols[i] += b.arr[i];
+            }
+            BigInt result = fromColumns(pos);
+            if (!neg.empty())
+                result -= fromColumns(neg);
+            return result;
+        }
+        template<typename Range>
+        friend BigInt sum(const Range& r) {
+            return sum(std::begin(r), std::end(r));
+        }
+        //Multiplies all numbers with a balanced product tree so the operands of each
+        //multiplication stay about the same size. The product of an empty range is 1.
+        template<typename Iter>
+        friend BigInt product(Iter first, Iter last, bool parallel = false) {
+            std::vector<const BigInt*> p;
+            for (; first != last; ++first)
+                p.push_back(&*first);
+            if (p.empty())
+                return BigInt(1, 1);
+            int threads = parallel? (int)std::thread::hardware_concurrency() : 1;
+            return productRange(p.data(), 0, p.size(), threads);
+        }
+        template<typename Range>
+        friend BigInt product(const Range& r, bool parallel = false) {
+            return product(std::begin(r), std::end(r), parallel);
+        }
+        //Sum of pairwise products. Each digit product goes straight into column sums, so no
+        //intermediate product is ever normalized or allocated.
+        template<typename Iter1, typename Iter2>
+        friend BigInt dot(Iter1 first1, Iter1 last1, Iter2 first2) {
+            std::vector<unsigned long long> pos, neg;
+            for (; first1 != last1; ++first1, ++first2) {
+                const BigInt& a = *first1;
+                const BigInt& b = *first2;
+                if ((a.inUse == 1 && a.arr[0] == 0) || (b.inUse == 1 && b.arr[0] == 0))
+                    continue;
+                std::vector<unsigned long long>& cols = (a.isNeg != b.isNeg)? neg : pos;
+                if (cols.size() < (size_t)(a.inUse + b.inUse))
+                    cols.resize(a.inUse + b.inUse, 0);
+                for (int i = 0; i < a.inUse; ++i) {
+                    if (a.arr[i] == 0) continue;
+                    for (int j = 0; j < b.inUse; ++j)
+                        cols[i+j] += a.arr[i] * b.arr[j];
+                }
+            }
+            BigInt result = fromColumns(pos);
+            if (!neg.empty())
+                result -= fromColumns(neg);
+            return result;
+        }
+        template<typename Range1, typename Range2>
+        friend BigInt dot(const Range1& a, const Range2& b) {
+            return dot(std::begin(a), std::end(a), std::begin(b));
+        }
         friend std::string to_string(const BigInt& b) {return (std::string)b;}
         friend std::ostream& operator<<(std::ostream& os, const BigInt& b);
         friend std::istream& operator>>(std::istream& os, BigInt& b);
     };
 
+    /* A read-only, non-owning view of a number held in someone else's memory: either a
+     * serialized number (packed digits) or a plain array of digits, least significant first,
+     * as BigInt itself stores them. The memory must outlive the view.
+     */
+    class BigIntView {
+        private:
+        const unsigned char* bytes;     //serialized form, or NULL
+        const unsigned short* digits;   //unpacked digits, or NULL
+        int inUse;
+        bool isNeg;
+
+        //digit at position i, counting from the least significant digit
+        unsigned short digit(int i) const {
+            if (digits)
+                return digits[i];
+            unsigned char c = bytes[BigInt::serial_header + i/2];
+            return (i % 2)? c >> 4 : c & 0x0F;
+        }
+        bool isZero() const {return inUse == 1 && digit(0) == 0;}
+        static void checkCapacity(size_t needed, size_t capacity, const char* where) {
+            if (capacity < needed)
+                throw indexOutOfRange(where);
+        }
+        //magnitude comparison
+        static int compareMagnitude(const BigIntView& a, const BigIntView& b) {
+            if (a.inUse != b.inUse)
+                return (a.inUse > b.inUse)? 1 : -1;
+            for (int i = a.inUse-1; i >= 0; --i) {
+                if (a.digit(i) != b.digit(i))
+                    return (a.digit(i) > b.digit(i))? 1 : -1;
+            }
+            return 0;
+        }
+        //view of out[0, n) with leading zeros dropped. Zero is never negative.
+        static BigIntView result(const unsigned short* out, int n, bool neg) {
+            while (n > 1 && out[n-1] == 0) --n;
+            BigIntView v;
+            v.bytes = NULL; v.digits = out; v.inUse = n;
+            v.isNeg = neg && !(n == 1 && out[0] == 0);
+            return v;
+        }
+        static BigIntView fromBigInt(const BigInt& b, unsigned short* out, size_t capacity, const char* where) {
+            checkCapacity(b.inUse, capacity, where);
+            std::copy(b.arr, b.arr + b.inUse, out);
+            return result(out, b.inUse, b.isNeg);
+        }
+        BigIntView() {}
+        friend class BigInt;
+        public:
+        //Throws invalidFormat if data does not start with a valid serialized number.
+        BigIntView(const unsigned char* data, size_t size) {
+            if (data == NULL || size < BigInt::serial_header || data[0] != BigInt::serial_version || data[1] > 1)
+                throw invalidFormat("In BigIntView. Invalid header.");
+            unsigned int count = 0;
+            for (int i = 3; i >= 0; --i)
+                count = (count << 8) | data[2+i];
+            if (count == 0 || count > 0x7FFFFFFF || (size - BigInt::serial_header) < (count + 1) / 2)
+                throw invalidFormat("In BigIntView. Invalid length.");
+            bytes = data; digits = NULL; inUse = count; isNeg = data[1];
+            for (int i = 0; i < inUse; ++i) {
+                if (digit(i) > 9)
+                    throw invalidFormat("In BigIntView. Invalid digit.");
+            }
+            if (count % 2 && (data[BigInt::serial_header + count/2] >> 4))
+                throw invalidFormat("In BigIntView. Invalid padding.");
+            if (inUse > 1 && digit(inUse-1) == 0)
+                throw invalidFormat("In BigIntView. Leading zero.");
+            if (isNeg && inUse == 1 && digit(0) == 0)
+                throw invalidFormat("In BigIntView. Negative zero.");
+        }
+        //count digits, least significant first. Leading zeros are ignored and zero is never
+        //negative. Throws invalidFormat if count is 0 or a digit is above 9.
+        BigIntView(const unsigned short* data, size_t count, bool negative) {
+            if (data == NULL || count == 0 || count > 0x7FFFFFFF)
+                throw invalidFormat("In BigIntView. Invalid length.");
+            for (size_t i = 0; i < count; ++i) {
+                if (data[i] > 9)
+                    throw invalidFormat("In BigIntView. Invalid digit.");
+            }
+            while (count > 1 && data[count-1] == 0) --count;
+            bytes = NULL; digits = data; inUse = count;
+            isNeg = negative && !(count == 1 && data[0] == 0);
+        }
+        size_t length() const {return inUse;}
+        bool is_negative() const {return isNeg;}
+        //number of bytes a serialized number occupies in the buffer
+        size_t size_bytes() const {return BigInt::serial_header + (inUse + 1) / 2;}
+        //the serialized form, or NULL for a view of plain digits
+        const unsigned char* data() const {return bytes;}
+
+        unsigned short operator[] (unsigned int i) const {
+            if (i >= (unsigned int)inUse)
+                throw indexOutOfRange("In BigIntView::range_check. Index is out of range.");
+            return digit(inUse-i-1);
+        }
+        int compare(const BigIntView& v) const {
+            if (isNeg != v.isNeg)
+                return isNeg? -1 : 1;
+            int c = compareMagnitude(*this, v);
+            return isNeg? -c : c;
+        }
+        int compare(const BigInt& b) const {
+            return compare(b.view());
+        }
+        //Hashes the digits sixteen at a time (one nibble each). BigInt::hash() uses this too.
+        size_t hash() const {
+            unsigned long long h = BigInt::hashMix(inUse, isNeg);
+            for (int i = 0; i < inUse; i += 16) {
+                unsigned long long block = 0;
+                for (int j = (i+16 < inUse? i+16 : inUse) - 1; j >= i; --j)
+                    block = (block << 4) | digit(j);
+                h = BigInt::hashMix(block, h);
+            }
+            return (size_t)BigInt::hashMix(h, inUse);
+        }
+        explicit operator std::string() const {
+            std::string result;
+            if (isNeg)
+                result += '-';
+            for (int i = inUse-1; i >= 0; --i)
+                result += '0' + digit(i);
+            return result;
+        }
+        friend std::string to_string(const BigIntView& v) {return (std::string)v;}
+        friend std::ostream& operator<<(std::ostream& os, const BigIntView& v) {
+            return os << (std::string)v;
+        }
+
+        /*------------------------------Kernels on views-----------------------------------
+         * Each writes its result, least significant digit first, into the caller's buffer
+         * out[0, capacity) and returns a view of it. out must not overlap the operands.
+         * They throw indexOutOfRange if capacity is below the size given for each.
+         */
+        //writes the text and a terminating '\0'. capacity: length() + 2. Returns the text length.
+        friend size_t format(const BigIntView& v, char* out, size_t capacity) {
+            size_t n = v.inUse + (v.isNeg? 1 : 0);
+            checkCapacity(n + 1, capacity, "In format. Buffer is too small.");
+            char* p = out;
+            if (v.isNeg) *p++ = '-';
+            for (int i = v.inUse-1; i >= 0; --i)
+                *p++ = '0' + v.digit(i);
+            *p = '\0';
+            return n;
+        }
+        //capacity: max(a.length(), b.length()) + 1
+        friend BigIntView add(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            int n = (a.inUse > b.inUse? a.inUse : b.inUse) + 1;
+            checkCapacity(n, capacity, "In add. Buffer is too small.");
+            if (a.isNeg == b.isNeg) {
+                unsigned int carry = 0;
+                for (int i = 0; i < n; ++i) {
+                    carry += (i < a.inUse? a.digit(i) : 0) + (i < b.inUse? b.digit(i) : 0);
+                    out[i] = carry % 10;
+                    carry /= 10;
+                }
+                return result(out, n, a.isNeg);
+            }
+            //different signs: subtract the smaller magnitude from the larger
+            int c = compareMagnitude(a, b);
+            const BigIntView& l = (c >= 0)? a : b;
+            const BigIntView& s = (c >= 0)? b : a;
+            int borrow = 0;
+            for (int i = 0; i < n; ++i) {
+                int d = (i < l.inUse? l.digit(i) : 0) - (i < s.inUse? s.digit(i) : 0) - borrow;
+                borrow = d < 0;
+                out[i] = d + (borrow? 10 : 0);
+            }
+            return result(out, n, l.isNeg);
+        }
+        //capacity: max(a.length(), b.length()) + 1
+        friend BigIntView subtract(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            BigIntView negB = b;
+            negB.isNeg = !b.isNeg && !b.isZero();
+            return add(a, negB, out, capacity);
+        }
+        //capacity: a.length() + b.length()
+        friend BigIntView multiply(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            return multiplyDigits(a, b, out, capacity);
+        }
+        /* Truncated division, like BigInt's / and %. Throws divisionByZero if b is zero.
+         * Divisors of up to 18 digits are divided in a single pass over a. Longer divisors go
+         * through temporary BigInts.
+         */
+        //capacity: a.length()
+        friend BigIntView divide(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            return divmod(a, b, out, capacity, true);
+        }
+        //capacity: b.length()
+        friend BigIntView modulo(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            return divmod(a, b, out, capacity, false);
+        }
+        private:
+        static BigIntView multiplyDigits(const BigIntView& a, const BigIntView& b, unsigned short* out, size_t capacity) {
+            int n = a.inUse + b.inUse;
+            checkCapacity(n, capacity, "In multiply. Buffer is too small.");
+            const BigIntView& s = (a.inUse < b.inUse)? a : b;
+            const BigIntView& l = (a.inUse < b.inUse)? b : a;
+            int threshold = BigInt::tuning().karatsuba;
+            if (s.inUse >= threshold) {
+                std::vector<long long> sc(s.inUse), lc(l.inUse);
+                for (int i = 0; i < s.inUse; ++i) sc[i] = s.digit(i);
+                for (int i = 0; i < l.inUse; ++i) lc[i] = l.digit(i);
+                n = BigInt::karatsubaDigits(sc, lc, out, threshold);
+            }
+            else {
+                std::fill_n(out, n, 0);
+                for (int i = 0; i < s.inUse; ++i) {
+                    unsigned int carry = 0, d = s.digit(i);
+                    if (d == 0) continue;
+                    for (int j = 0; j < l.inUse; ++j) {
+                        carry += out[i+j] + d * l.digit(j);
+                        out[i+j] = carry % 10;
+                        carry /= 10;
+                    }
+                    out[i + l.inUse] = carry;
+                }
+            }
+            return result(out, n, a.isNeg != b.isNeg);
+        }
+        static BigIntView divmod(const BigIntView& a, const BigIntView& b, unsigned short* out,
+            size_t capacity, bool quotient) {
+            if (b.isZero())
+                throw divisionByZero("In BigIntView. Division by zero.");
+            const char* where = quotient? "In divide. Buffer is too small." : "In modulo. Buffer is too small.";
+            checkCapacity(quotient? a.inUse : b.inUse, capacity, where);
+            bool neg = quotient? a.isNeg != b.isNeg : a.isNeg;
+            if (b.inUse <= 18) {
+                unsigned long long d = 0, rem = 0;
+                for (int i = b.inUse-1; i >= 0; --i)
+                    d = d * 10 + b.digit(i);
+                for (int i = a.inUse-1; i >= 0; --i) {
+                    rem = rem * 10 + a.digit(i);
+                    if (quotient)
+                        out[i] = rem / d;
+                    rem %= d;
+                }
+                if (quotient)
+                    return result(out, a.inUse, neg);
+                int n = 0;
+                do {
+                    out[n++] = rem % 10;
+                    rem /= 10;
+                } while (rem);
+                return result(out, n, neg);
+            }
+            BigInt x(a), y(b), q, r;
+            x.divmodMagnitude(y, quotient? &q : NULL, quotient? NULL : &r);
+            BigIntView v = fromBigInt(quotient? q : r, out, capacity, where);
+            v.isNeg = neg && !v.isZero();
+            return v;
+        }
+    };
+
+    BigInt::BigInt(const BigIntView& v) {
+        allocated = v.inUse;
+        inUse = v.inUse;
+        isNeg = v.isNeg;
+        arr = new s_type[allocated];
+        for (int i = 0; i < inUse; ++i)
+            arr[i] = v.digit(i);
+    }
+    BigIntView BigInt::view() const {
+        return BigIntView::result(arr, inUse, isNeg);
+    }
+    size_t BigInt::hash() const {
+        return view().hash();
+    }
+    BigInt BigInt::deserialize(const unsigned char* data, size_t size) {
+        return BigInt(BigIntView(data, size));
+    }
+
     /*------------------relational operators------------*/
     bool operator<(const BigInt& lhs, const BigInt& rhs) {
         return lhs.compare(rhs) < 0;
@@ -1059,6 +3107,66 @@ namespace my {
     bool operator!=(const BigInt& lhs, const BigInt& rhs) {
         return lhs.compare(rhs) != 0;
     }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) < 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<(T lhs, const BigInt& rhs) {
+        return 0 < rhs.compare(lhs);
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<=(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) <= 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<=(T lhs, const BigInt& rhs) {
+        return 0 <= rhs.compare(lhs);
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) > 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>(T lhs, const BigInt& rhs) {
+        return 0 > rhs.compare(lhs);
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>=(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) >= 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>=(T lhs, const BigInt& rhs) {
+        return 0 >= rhs.compare(lhs);
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator==(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) == 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator==(T lhs, const BigInt& rhs) {
+        return 0 == rhs.compare(lhs);
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator!=(const BigInt& lhs, T rhs) {
+        return lhs.compare(rhs) != 0;
+    }
+    template <typename T,
+        typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator!=(T lhs, const BigInt& rhs) {
+        return 0 != rhs.compare(lhs);
+    }
     /*----------------------------------------------------*/
     
     std::ostream& operator<<(std::ostream& os, const BigInt& b) {
@@ -1081,5 +3189,855 @@ namespace my {
             result *= n;
         return result;
     }       
+
+    //Multiplies by as many consecutive factors as fit below 10^18 in each step.
+    //Checks token before every step and throws operationCancelled once it has been cancelled.
+    //Step i costs about as much as i! has digits, roughly i log i, so progress is estimated as
+    //the integral of that up to i over the integral up to n.
+    BigInt factorial(unsigned int n, const CancellationToken& token,
+        const ProgressCallback& progress = ProgressCallback()) {
+        struct Work {
+            static double upTo(double x) {return x * x * (2 * std::log(x) - 1);}
+        };
+        BigInt result(1,1);
+        unsigned long long i = 2;
+        while (i <= n) {
+            token.throw_if_cancelled();
+            if (progress) progress(Work::upTo(i) / Work::upTo(n));
+            unsigned long long m = 1;
+            for (; i <= n && m <= 1000000000000000000ULL / i; ++i)
+                m *= i;
+            result *= m;
+        }
+        if (progress) progress(1.0);
+        return result;
+    }
+
+    /*----------------------------Fibonacci numbers and recurrences----------------------------
+     * Each function has an overload that works modulo a positive BigInt, which throws
+     * invalidArgument otherwise. Results modulo m are in [0, m).
+     */
+    namespace detail {
+        //reduces x into [0, m) when m is not NULL
+        void reduce_modulo(BigInt& x, const BigInt* m) {
+            if (m) {
+                x %= *m;
+                if (x.is_negative()) x += *m;
+            }
+        }
+        void check_modulus(const BigInt& m, const char* where) {
+            if (m.compare(0) <= 0)
+                throw invalidArgument(where);
+        }
+        /* Sets fn = F(n) and fn1 = F(n+1) by fast doubling over the bits of n:
+         * F(2k) = F(k) * (2F(k+1) - F(k)) and F(2k+1) = F(k)^2 + F(k+1)^2.
+         */
+        void fibonacci_pair(unsigned long long n, BigInt& fn, BigInt& fn1, const BigInt* mod) {
+            fn = 0; fn1 = 1;
+            reduce_modulo(fn1, mod);
+            int bit = 63;
+            while (bit >= 0 && !((n >> bit) & 1)) --bit;
+            BigInt t;
+            for (; bit >= 0; --bit) {
+                t = fn1;
+                t *= 2;
+                t -= fn;
+                t *= fn;        //F(2k)
+                fn *= fn;
+                fn1 *= fn1;
+                fn1 += fn;      //F(2k+1)
+                fn = std::move(t);
+                if ((n >> bit) & 1) {
+                    fn += fn1;
+                    swap(fn, fn1);
+                }
+                reduce_modulo(fn, mod);
+                reduce_modulo(fn1, mod);
+            }
+        }
+        /* a(n) for a(i) = coeffs[0]*a(i-1) + coeffs[1]*a(i-2) + ... + coeffs[k-1]*a(i-k), with
+         * a(0), ..., a(k-1) given by init. Computes x^n modulo the characteristic polynomial by
+         * repeated squaring (Kitamasa's method): O(k^2 log n) multiplications.
+         * Throws invalidArgument if coeffs is empty or init has a different size.
+         */
+        BigInt linear_recurrence(const std::vector<BigInt>& coeffs, const std::vector<BigInt>& init,
+            unsigned long long n, const BigInt* mod) {
+            size_t k = coeffs.size();
+            if (k == 0 || init.size() != k)
+                throw invalidArgument("In linear_recurrence. Need as many initial values as coefficients.");
+            if (n < k) {
+                BigInt r = init[n];
+                reduce_modulo(r, mod);
+                return r;
+            }
+            //poly = poly * factor modulo the characteristic polynomial, with prod holding the full product
+            std::vector<BigInt> prod(2*k - 1);
+            auto mulMod = [&](std::vector<BigInt>& poly, const std::vector<BigInt>& factor) {
+                for (size_t i = 0; i < prod.size(); ++i)
+                    prod[i] = 0;
+                for (size_t i = 0; i < k; ++i) {
+                    if (poly[i].compare(0) == 0) continue;
+                    for (size_t j = 0; j < k; ++j)
+                        prod[i+j] += poly[i] * factor[j];
+                }
+                //x^k = coeffs[0] x^(k-1) + ... + coeffs[k-1]
+                for (size_t i = 2*k - 2; i >= k; --i) {
+                    reduce_modulo(prod[i], mod);
+                    if (prod[i].compare(0) == 0) continue;
+                    for (size_t j = 0; j < k; ++j)
+                        prod[i-1-j] += prod[i] * coeffs[j];
+                }
+                for (size_t i = 0; i < k; ++i) {
+                    reduce_modulo(prod[i], mod);
+                    swap(poly[i], prod[i]);
+                }
+            };
+            //result = x^n, base = x (or x mod the characteristic polynomial when k == 1)
+            std::vector<BigInt> result(k), base(k);
+            result[0] = 1;
+            if (k == 1) base[0] = coeffs[0];
+            else base[1] = 1;
+            for (size_t i = 0; i < k; ++i) {
+                reduce_modulo(result[i], mod);
+                reduce_modulo(base[i], mod);
+            }
+            for (unsigned long long e = n; e > 0; e >>= 1) {
+                if (e & 1)
+                    mulMod(result, base);
+                if (e > 1)
+                    mulMod(base, base);
+            }
+            BigInt r;
+            for (size_t i = 0; i < k; ++i)
+                r += result[i] * init[i];
+            reduce_modulo(r, mod);
+            return r;
+        }
+    }
+    //Sets fn = F(n) and fn1 = F(n+1).
+    void fibonacci_pair(unsigned long long n, BigInt& fn, BigInt& fn1) {
+        detail::fibonacci_pair(n, fn, fn1, NULL);
+    }
+    void fibonacci_pair(unsigned long long n, BigInt& fn, BigInt& fn1, const BigInt& mod) {
+        detail::check_modulus(mod, "In fibonacci_pair. Modulus must be positive.");
+        detail::fibonacci_pair(n, fn, fn1, &mod);
+    }
+    BigInt fibonacci(unsigned long long n) {
+        BigInt f, g;
+        detail::fibonacci_pair(n, f, g, NULL);
+        return f;
+    }
+    BigInt fibonacci(unsigned long long n, const BigInt& mod) {
+        detail::check_modulus(mod, "In fibonacci. Modulus must be positive.");
+        BigInt f, g;
+        detail::fibonacci_pair(n, f, g, &mod);
+        return f;
+    }
+    //L(n) = 2F(n+1) - F(n)
+    BigInt lucas(unsigned long long n) {
+        BigInt f, g;
+        detail::fibonacci_pair(n, f, g, NULL);
+        g *= 2;
+        return g -= f;
+    }
+    BigInt lucas(unsigned long long n, const BigInt& mod) {
+        detail::check_modulus(mod, "In lucas. Modulus must be positive.");
+        BigInt f, g;
+        detail::fibonacci_pair(n, f, g, &mod);
+        g *= 2;
+        g -= f;
+        detail::reduce_modulo(g, &mod);
+        return g;
+    }
+    BigInt linear_recurrence(const std::vector<BigInt>& coeffs, const std::vector<BigInt>& init,
+        unsigned long long n) {
+        return detail::linear_recurrence(coeffs, init, n, NULL);
+    }
+    BigInt linear_recurrence(const std::vector<BigInt>& coeffs, const std::vector<BigInt>& init,
+        unsigned long long n, const BigInt& mod) {
+        detail::check_modulus(mod, "In linear_recurrence. Modulus must be positive.");
+        return detail::linear_recurrence(coeffs, init, n, &mod);
+    }
+
+    //uniformly random non-negative number below 2^bits, drawn from any standard random engine
+    template<typename URNG>
+    BigInt random_bits(size_t bits, URNG& gen) {
+        if (bits == 0)
+            return BigInt();
+        std::vector<unsigned char> bytes(bits / 8);
+        std::uniform_int_distribution<unsigned int> byte(0, 255);
+        for (size_t i = 0; i < bytes.size(); ++i)
+            bytes[i] = byte(gen);
+        //the partial top byte is drawn from its own range instead of being masked
+        if (bits % 8)
+            bytes.push_back(std::uniform_int_distribution<unsigned int>(0, (1u << (bits % 8)) - 1)(gen));
+        return BigInt::from_bytes(bytes.data(), bytes.size(), false);
+    }
+    //uniformly random number in [0, n) by rejection sampling. n must be positive.
+    template<typename URNG>
+    BigInt random_below(const BigInt& n, URNG& gen) {
+        if (n.compare(0) <= 0)
+            throw invalidArgument("In BigInt::random_below. Bound must be positive.");
+        size_t bits = n.bit_length();
+        while (true) {
+            BigInt r = random_bits(bits, gen);
+            if (r < n)
+                return r;
+        }
+    }
+
+    //An immutable BigInt that computes its hash once. Useful as a key that is looked up often.
+    class HashedBigInt {
+        private:
+        BigInt val;
+        size_t h;
+        public:
+        HashedBigInt(const BigInt& b): val(b), h(b.hash()) {}
+        HashedBigInt(BigInt&& b): val(std::move(b)), h(val.hash()) {}
+        const BigInt& value() const {return val;}
+        size_t hash() const {return h;}
+        friend bool operator==(const HashedBigInt& lhs, const HashedBigInt& rhs) {
+            return lhs.h == rhs.h && lhs.val == rhs.val;
+        }
+        friend bool operator!=(const HashedBigInt& lhs, const HashedBigInt& rhs) {
+            return !(lhs == rhs);
+        }
+    };
+
+    /* Copy-on-write handle to a BigInt. Copies share one buffer and cost O(1); the reference
+     * count is atomic, so handles can be passed between threads. Reading goes through value()
+     * or the conversion to const BigInt&. modify(f) gives write access, copying the number first
+     * if another handle still shares it, so a handle never sees changes made through another.
+     * Thread safety is that of shared_ptr: different handles, even ones sharing a buffer, can be
+     * used on different threads at once, but one handle must not be used by two threads at once
+     * without a lock.
+     */
+    class SharedBigInt {
+        private:
+        std::shared_ptr<BigInt> ptr;
+        public:
+        SharedBigInt(): ptr(std::make_shared<BigInt>()) {}
+        explicit SharedBigInt(const BigInt& b): ptr(std::make_shared<BigInt>(b)) {}
+        explicit SharedBigInt(BigInt&& b): ptr(std::make_shared<BigInt>(std::move(b))) {}
+        const BigInt& value() const {return *ptr;}
+        operator const BigInt&() const {return *ptr;}
+        const BigInt& operator*() const {return *ptr;}
+        const BigInt* operator->() const {return ptr.get();}
+        //number of handles sharing the buffer
+        long use_count() const {return ptr.use_count();}
+        //Calls f(BigInt&) on a buffer no other handle shares. The reference must not be kept
+        //after f returns, since a later copy of this handle would share what it points to.
+        template<typename F> void modify(F f) {
+            if (ptr.use_count() != 1)
+                ptr = std::make_shared<BigInt>(*ptr);
+            else
+                //use_count() is a relaxed load. A handle released on another thread dropped the
+                //count with a release decrement; this fence orders that thread's last reads of
+                //the buffer before the writes made by f.
+                std::atomic_thread_fence(std::memory_order_acquire);
+            f(*ptr);
+        }
+        size_t hash() const {return ptr->hash();}
+
+        template<typename T> SharedBigInt& operator+=(const T& t) {modify([&t](BigInt& v) {v += t;}); return *this;}
+        template<typename T> SharedBigInt& operator-=(const T& t) {modify([&t](BigInt& v) {v -= t;}); return *this;}
+        template<typename T> SharedBigInt& operator*=(const T& t) {modify([&t](BigInt& v) {v *= t;}); return *this;}
+        template<typename T> SharedBigInt& operator/=(const T& t) {modify([&t](BigInt& v) {v /= t;}); return *this;}
+        template<typename T> SharedBigInt& operator%=(const T& t) {modify([&t](BigInt& v) {v %= t;}); return *this;}
+        SharedBigInt& operator++() {modify([](BigInt& v) {++v;}); return *this;}
+        SharedBigInt& operator--() {modify([](BigInt& v) {--v;}); return *this;}
+
+        //T is a BigInt, a SharedBigInt or an integral type
+        template<typename T> friend BigInt operator+(const SharedBigInt& a, const T& b) {BigInt r = *a; r += b; return r;}
+        template<typename T> friend BigInt operator-(const SharedBigInt& a, const T& b) {BigInt r = *a; r -= b; return r;}
+        template<typename T> friend BigInt operator*(const SharedBigInt& a, const T& b) {BigInt r = *a; r *= b; return r;}
+        template<typename T> friend BigInt operator/(const SharedBigInt& a, const T& b) {BigInt r = *a; r /= b; return r;}
+        template<typename T> friend BigInt operator%(const SharedBigInt& a, const T& b) {BigInt r = *a; r %= b; return r;}
+        template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        friend BigInt operator+(T t, const SharedBigInt& b) {BigInt r(t); r += *b; return r;}
+        template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        friend BigInt operator-(T t, const SharedBigInt& b) {BigInt r(t); r -= *b; return r;}
+        template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        friend BigInt operator*(T t, const SharedBigInt& b) {BigInt r(t); r *= *b; return r;}
+        friend BigInt operator-(const SharedBigInt& a) {BigInt r = *a; r.negate(); return r;}
+    };
+
+    /* A fixed set of worker threads that run queued jobs in order. The async functions below use
+     * ThreadPool::shared(), sized to the hardware, unless given another pool. The destructor
+     * finishes the queued jobs and joins the workers.
+     */
+    class ThreadPool {
+        private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()> > jobs;
+        std::mutex lock;
+        std::condition_variable ready;
+        bool stopping;
+
+        void work() {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    ready.wait(guard, [this] {return stopping || !jobs.empty();});
+                    if (jobs.empty())
+                        return;
+                    job = std::move(jobs.front());
+                    jobs.pop();
+                }
+                job();
+            }
+        }
+        public:
+        explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency()): stopping(false) {
+            if (threads == 0) threads = 1;
+            for (unsigned int i = 0; i < threads; ++i)
+                workers.emplace_back(&ThreadPool::work, this);
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            ready.notify_all();
+            for (size_t i = 0; i < workers.size(); ++i)
+                workers[i].join();
+        }
+        size_t size() const {return workers.size();}
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                jobs.push(std::move(job));
+            }
+            ready.notify_one();
+        }
+        //runs f on the pool. Exceptions thrown by f are rethrown by the future's get().
+        template<typename F>
+        std::future<BigInt> enqueue(F f) {
+            std::shared_ptr<std::packaged_task<BigInt()> > task =
+                std::make_shared<std::packaged_task<BigInt()> >(f);
+            std::future<BigInt> result = task->get_future();
+            submit([task] {(*task)();});
+            return result;
+        }
+        static ThreadPool& shared() {
+            static ThreadPool pool;
+            return pool;
+        }
+    };
+
+    /* The cancellable operations run on a thread pool. Cancelling the token makes the future
+     * throw operationCancelled at its next step; the worker thread is free again right after.
+     */
+    std::future<BigInt> async_pow(const BigInt& x, unsigned int y,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return pool.enqueue([x, y, token, progress] {return pow(x, y, token, progress);});
+    }
+    std::future<BigInt> async_factorial(unsigned int n,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return pool.enqueue([n, token, progress] {return factorial(n, token, progress);});
+    }
+    std::future<BigInt> async_multiply(const BigInt& a, const BigInt& b,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return pool.enqueue([a, b, token, progress] {return multiply(a, b, token, progress);});
+    }
+
+    #ifdef BIGINT_COROUTINES
+    /* co_await on the result of co_pow, co_factorial or co_multiply inside a C++20 coroutine
+     * runs the computation on the pool and resumes the coroutine on the pool thread when it
+     * finishes, so no thread is blocked while waiting. Errors are rethrown by co_await.
+     */
+    class BigIntAwaitable {
+        private:
+        std::function<BigInt()> job;
+        ThreadPool* pool;
+        BigInt result;
+        std::exception_ptr error;
+        public:
+        BigIntAwaitable(std::function<BigInt()> f, ThreadPool& p): job(std::move(f)), pool(&p) {}
+        bool await_ready() const noexcept {return false;}
+        void await_suspend(std::coroutine_handle<> h) {
+            pool->submit([this, h] {
+                try {
+                    result = job();
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+                h.resume();
+            });
+        }
+        BigInt await_resume() {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(result);
+        }
+    };
+    BigIntAwaitable co_pow(const BigInt& x, unsigned int y,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return BigIntAwaitable([x, y, token, progress] {return pow(x, y, token, progress);}, pool);
+    }
+    BigIntAwaitable co_factorial(unsigned int n,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return BigIntAwaitable([n, token, progress] {return factorial(n, token, progress);}, pool);
+    }
+    BigIntAwaitable co_multiply(const BigInt& a, const BigInt& b,
+        const CancellationToken& token = CancellationToken(),
+        const ProgressCallback& progress = ProgressCallback(), ThreadPool& pool = ThreadPool::shared()) {
+        return BigIntAwaitable([a, b, token, progress] {return multiply(a, b, token, progress);}, pool);
+    }
+    #endif
+
+    #ifdef __SIZEOF_INT128__
+    /* A number held as its residues modulo k primes just below 2^62 (a residue number system).
+     * +, - and * work on each residue on its own, so they take O(k) word operations whatever
+     * the size of the number and the loops over the residues are independent. Only the
+     * conversions look at all residues together.
+     * A value is exact while |x| < 2^capacity_bits(); results outside that range wrap around
+     * silently, so size the number for the largest intermediate value. Operands of a binary
+     * operation must have the same number of primes, otherwise invalidArgument is thrown.
+     */
+    class RnsInt {
+        private:
+        typedef unsigned long long u64;
+        typedef unsigned __int128 u128;
+        //the primes and what is derived from them, shared by all numbers with the same count
+        struct Basis {
+            std::vector<u64> p;         //primes
+            std::vector<u64> pinv;      //-p^-1 mod 2^64
+            std::vector<u64> r2;        //2^128 mod p, to enter Montgomery form
+            std::vector<u64> crt;       //(M/p)^-1 mod p
+            std::vector<std::vector<BigInt> > tree; //subproduct tree; tree.back()[0] == M
+            BigInt half;                //M/2
+        };
+        std::shared_ptr<const Basis> basis;
+        std::vector<u64> r;             //residues in Montgomery form
+
+        //Montgomery reduction: t * 2^-64 mod p, for t < p * 2^64
+        static u64 redc(u128 t, u64 p, u64 pinv) {
+            u64 m = (u64)t * pinv;
+            u64 x = (u64)((t + (u128)m * p) >> 64);
+            return (x >= p)? x - p : x;
+        }
+        //primes below 2^62, largest first, extended as needed
+        static std::vector<u64> primes(size_t k) {
+            static std::vector<u64> list;
+            static std::mutex lock;
+            std::lock_guard<std::mutex> guard(lock);
+            u64 n = list.empty()? (1ULL << 62) + 1 : list.back();
+            while (list.size() < k) {
+                n -= 2;
+                if (BigInt::isPrime64(n))
+                    list.push_back(n);
+            }
+            return std::vector<u64>(list.begin(), list.begin() + k);
+        }
+        static std::shared_ptr<const Basis> basisFor(size_t k) {
+            static std::vector<std::shared_ptr<const Basis> > cache;
+            static std::mutex lock;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (k < cache.size() && cache[k])
+                    return cache[k];
+            }
+            std::shared_ptr<Basis> b = std::make_shared<Basis>();
+            b->p = primes(k);
+            for (size_t i = 0; i < k; ++i) {
+                u64 p = b->p[i], inv = p;       //p * p == 1 mod 8, then Newton doubles the bits
+                for (int j = 0; j < 5; ++j)
+                    inv *= 2 - p * inv;
+                b->pinv.push_back(0 - inv);
+                u64 r1 = (u64)(((u128)1 << 64) % p);
+                b->r2.push_back((u64)((u128)r1 * r1 % p));
+                u64 c = 1;
+                for (size_t j = 0; j < k; ++j) {
+                    if (j != i)
+                        c = (u64)((u128)c * (b->p[j] % p) % p);
+                }
+                b->crt.push_back(BigInt::powMod64(c, p - 2, p));
+            }
+            b->tree.push_back(std::vector<BigInt>());
+            for (size_t i = 0; i < k; ++i)
+                b->tree[0].push_back(BigInt(b->p[i]));
+            while (b->tree.back().size() > 1) {
+                const std::vector<BigInt>& below = b->tree.back();
+                std::vector<BigInt> level;
+                for (size_t i = 0; i + 1 < below.size(); i += 2)
+                    level.push_back(BigInt(below[i]) * below[i+1]);
+                if (below.size() % 2)
+                    level.push_back(below.back());
+                b->tree.push_back(level);
+            }
+            b->half = b->tree.back()[0];
+            b->half /= 2;
+            std::lock_guard<std::mutex> guard(lock);
+            if (cache.size() <= k)
+                cache.resize(k + 1);
+            if (!cache[k])
+                cache[k] = b;
+            return cache[k];
+        }
+        void check(const RnsInt& b) const {
+            if (basis != b.basis)
+                throw invalidArgument("In RnsInt. Operands have different numbers of primes.");
+        }
+        //residue i out of Montgomery form
+        u64 plain(size_t i) const {
+            return redc(r[i], basis->p[i], basis->pinv[i]);
+        }
+        //sum of the leaves scaled by the product of the other primes, combined up the subproduct
+        //tree: a node is left * M(right) + right * M(left).
+        BigInt combine(size_t level, size_t i, const std::vector<BigInt>& leaves) const {
+            if (level == 0)
+                return leaves[i];
+            const std::vector<BigInt>& below = basis->tree[level-1];
+            if (2*i + 1 >= below.size())
+                return combine(level-1, 2*i, leaves);
+            BigInt left = combine(level-1, 2*i, leaves), right = combine(level-1, 2*i + 1, leaves);
+            left *= subtreeProduct(level-1, 2*i + 1);
+            right *= subtreeProduct(level-1, 2*i);
+            return left += right;
+        }
+        const BigInt& subtreeProduct(size_t level, size_t i) const {
+            return basis->tree[level][i];
+        }
+        public:
+        //zero with a single prime
+        RnsInt(): basis(basisFor(1)), r(1, 0) {}
+        //chooses enough primes for |x| < 2^bits. Throws invalidArgument if b does not fit.
+        RnsInt(const BigInt& b, size_t bits) {
+            size_t k = (bits + 61) / 61;
+            basis = basisFor(k);
+            if (abs(b) > basis->half)
+                throw invalidArgument("In RnsInt. Value does not fit in the given number of bits.");
+            //the digits, 18 at a time from the top, fed to every prime by Horner's rule
+            std::vector<u64> chunks;
+            int len = (b.inUse % 18)? b.inUse % 18 : 18;
+            for (int hi = b.inUse; hi > 0; hi -= len, len = 18) {
+                u64 c = 0;
+                for (int j = hi - 1; j >= hi - len; --j)
+                    c = c * 10 + b.arr[j];
+                chunks.push_back(c);
+            }
+            bool neg = b.is_negative();
+            r.resize(k);
+            for (size_t i = 0; i < k; ++i) {
+                u64 p = basis->p[i], x = 0;
+                for (size_t j = 0; j < chunks.size(); ++j)
+                    x = (u64)(((u128)x * 1000000000000000000ULL + chunks[j]) % p);
+                if (neg && x != 0)
+                    x = p - x;
+                r[i] = redc((u128)x * basis->r2[i], p, basis->pinv[i]);
+            }
+        }
+        size_t moduli() const {return r.size();}
+        //every |x| < 2^capacity_bits() is represented exactly
+        size_t capacity_bits() const {return 61 * r.size() - 1;}
+
+        //Chinese remaindering over the subproduct tree, mapped to the range (-M/2, M/2].
+        BigInt to_BigInt() const {
+            size_t k = r.size();
+            std::vector<BigInt> leaves(k);
+            for (size_t i = 0; i < k; ++i) {
+                u64 p = basis->p[i];
+                leaves[i] = BigInt((u64)((u128)plain(i) * basis->crt[i] % p));
+            }
+            BigInt x = combine(basis->tree.size() - 1, 0, leaves);
+            const BigInt& M = basis->tree.back()[0];
+            x %= M;
+            if (x > basis->half)
+                x -= M;
+            return x;
+        }
+        explicit operator BigInt() const {return to_BigInt();}
+
+        RnsInt& operator+=(const RnsInt& b) {
+            check(b);
+            for (size_t i = 0; i < r.size(); ++i) {
+                u64 s = r[i] + b.r[i], p = basis->p[i];
+                r[i] = (s >= p)? s - p : s;
+            }
+            return *this;
+        }
+        RnsInt& operator-=(const RnsInt& b) {
+            check(b);
+            for (size_t i = 0; i < r.size(); ++i)
+                r[i] = (r[i] >= b.r[i])? r[i] - b.r[i] : r[i] + basis->p[i] - b.r[i];
+            return *this;
+        }
+        RnsInt& operator*=(const RnsInt& b) {
+            check(b);
+            for (size_t i = 0; i < r.size(); ++i)
+                r[i] = redc((u128)r[i] * b.r[i], basis->p[i], basis->pinv[i]);
+            return *this;
+        }
+        /* Exact division: correct only when b divides this. Multiplies each residue by the
+         * inverse of b's residue. Throws divisionByZero if b is zero and invalidArgument if b
+         * is a multiple of one of the primes.
+         */
+        RnsInt& operator/=(const RnsInt& b) {
+            check(b);
+            bool zero = true;
+            for (size_t i = 0; i < r.size() && zero; ++i)
+                zero = b.r[i] == 0;
+            if (zero)
+                throw divisionByZero("In RnsInt::operator/=. Division by zero.");
+            for (size_t i = 0; i < r.size(); ++i) {
+                u64 p = basis->p[i], d = b.plain(i);
+                if (d == 0)
+                    throw invalidArgument("In RnsInt::operator/=. Divisor shares a prime with the basis.");
+                u64 inv = BigInt::powMod64(d, p - 2, p);
+                u64 invMont = redc((u128)inv * basis->r2[i], p, basis->pinv[i]);
+                r[i] = redc((u128)r[i] * invMont, p, basis->pinv[i]);
+            }
+            return *this;
+        }
+        RnsInt operator-() const {
+            RnsInt x = *this;
+            for (size_t i = 0; i < r.size(); ++i)
+                x.r[i] = r[i]? basis->p[i] - r[i] : 0;
+            return x;
+        }
+        friend RnsInt operator+(RnsInt a, const RnsInt& b) {return a += b;}
+        friend RnsInt operator-(RnsInt a, const RnsInt& b) {return a -= b;}
+        friend RnsInt operator*(RnsInt a, const RnsInt& b) {return a *= b;}
+        friend RnsInt operator/(RnsInt a, const RnsInt& b) {return a /= b;}
+        friend bool operator==(const RnsInt& a, const RnsInt& b) {
+            a.check(b);
+            return a.r == b.r;
+        }
+        friend bool operator!=(const RnsInt& a, const RnsInt& b) {return !(a == b);}
+        friend std::ostream& operator<<(std::ostream& os, const RnsInt& x) {
+            return os << x.to_BigInt();
+        }
+    };
+    #endif
+
+    #if __cplusplus >= 201402L
+    /* Signed integer of a fixed number of bits (a positive multiple of 32) stored on the stack
+     * in two's complement. Arithmetic wraps around like the built-in integer types and every
+     * operation is constexpr, so values can also be computed at compile time.
+     */
+    template<unsigned int Bits>
+    class FixedBigInt {
+        static_assert(Bits > 0 && Bits % 32 == 0, "FixedBigInt: Bits must be a positive multiple of 32");
+        public:
+        static constexpr int limbs = Bits / 32;
+        private:
+        typedef unsigned int l_type;
+        l_type arr[limbs];
+
+        constexpr bool negative() const {return arr[limbs-1] >> 31;}
+        //limb i, sign extended past the top
+        constexpr l_type limb(int i) const {
+            return (i < limbs)? arr[i] : (negative()? 0xFFFFFFFF : 0);
+        }
+        constexpr void negateInPlace() {
+            unsigned long long carry = 1;
+            for (int i = 0; i < limbs; ++i) {
+                carry += (l_type)~arr[i];
+                arr[i] = (l_type)carry;
+                carry >>= 32;
+            }
+        }
+        //absolute value read as an unsigned number, so it is also correct for the minimum value
+        constexpr FixedBigInt magnitude() const {
+            FixedBigInt r = *this;
+            if (r.negative()) r.negateInPlace();
+            return r;
+        }
+        static constexpr int compareUnsigned(const FixedBigInt& a, const FixedBigInt& b) {
+            for (int i = limbs-1; i >= 0; --i) {
+                if (a.arr[i] != b.arr[i])
+                    return (a.arr[i] > b.arr[i])? 1 : -1;
+            }
+            return 0;
+        }
+        constexpr void subtractUnsigned(const FixedBigInt& b) {
+            long long borrow = 0;
+            for (int i = 0; i < limbs; ++i) {
+                long long sub = (long long)arr[i] - b.arr[i] - borrow;
+                borrow = (sub < 0)? 1 : 0;
+                arr[i] = (l_type)sub;
+            }
+        }
+        //shift-subtract division of unsigned values, starting at the top set bit of n
+        static constexpr void divmodUnsigned(const FixedBigInt& n, const FixedBigInt& d, FixedBigInt& q, FixedBigInt& r) {
+            q = FixedBigInt(); r = FixedBigInt();
+            int top = Bits-1;
+            while (top >= 0 && !((n.arr[top/32] >> (top%32)) & 1)) --top;
+            for (int i = top; i >= 0; --i) {
+                for (int j = limbs-1; j > 0; --j)
+                    r.arr[j] = (r.arr[j] << 1) | (r.arr[j-1] >> 31);
+                r.arr[0] = (r.arr[0] << 1) | ((n.arr[i/32] >> (i%32)) & 1);
+                if (compareUnsigned(r, d) >= 0) {
+                    r.subtractUnsigned(d);
+                    q.arr[i/32] |= 1u << (i%32);
+                }
+            }
+        }
+        //quotient truncated toward zero and remainder with the sign of the dividend, like BigInt
+        static constexpr void divmod(const FixedBigInt& a, const FixedBigInt& b, FixedBigInt& q, FixedBigInt& r) {
+            if (!b)
+                throw divisionByZero("Error In FixedBigInt: divisionByZero check\n");
+            divmodUnsigned(a.magnitude(), b.magnitude(), q, r);
+            if (a.negative() != b.negative()) q.negateInPlace();
+            if (a.negative()) r.negateInPlace();
+        }
+        public:
+        constexpr FixedBigInt(): arr() {}
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        constexpr FixedBigInt(T n): arr() {
+            unsigned long long u = (unsigned long long)n;
+            bool neg = std::is_signed<T>::value && n < T(0);
+            for (int i = 0; i < limbs; ++i) {
+                arr[i] = (i < 2)? (l_type)(u >> (32*i)) : (neg? 0xFFFFFFFF : 0);
+            }
+        }
+        //keeps the low Bits bits of b, like a conversion between built-in integer types
+        explicit FixedBigInt(const BigInt& b): arr() {
+            std::vector<unsigned char> bytes = b.export_words(4, -1, -1);
+            for (size_t i = 0; i < bytes.size() && i/4 < (size_t)limbs; ++i)
+                arr[i/4] |= (l_type)bytes[i] << (8*(i%4));
+            if (b.is_negative()) negateInPlace();
+        }
+        explicit operator BigInt() const {
+            FixedBigInt m = magnitude();
+            unsigned char bytes[limbs*4];
+            for (int i = 0; i < limbs*4; ++i)
+                bytes[i] = (m.arr[i/4] >> (8*(i%4))) & 0xFF;
+            BigInt result = BigInt::import_words(bytes, limbs*4, 1, -1, 0);
+            if (negative()) result.negate();
+            return result;
+        }
+        template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value>::type>
+        constexpr explicit operator T() const {
+            return (T)(limb(0) | ((unsigned long long)limb(1) << 32));
+        }
+        constexpr explicit operator bool() const {
+            for (int i = 0; i < limbs; ++i) {
+                if (arr[i]) return true;
+            }
+            return false;
+        }
+        constexpr int compare(const FixedBigInt& b) const {
+            if (negative() != b.negative())
+                return negative()? -1 : 1;
+            return compareUnsigned(*this, b);
+        }
+        constexpr FixedBigInt& operator+=(const FixedBigInt& b) {
+            unsigned long long carry = 0;
+            for (int i = 0; i < limbs; ++i) {
+                carry += (unsigned long long)arr[i] + b.arr[i];
+                arr[i] = (l_type)carry;
+                carry >>= 32;
+            }
+            return *this;
+        }
+        constexpr FixedBigInt& operator-=(const FixedBigInt& b) {
+            subtractUnsigned(b);
+            return *this;
+        }
+        constexpr FixedBigInt& operator*=(const FixedBigInt& b) {
+            FixedBigInt r;
+            for (int i = 0; i < limbs; ++i) {
+                unsigned long long carry = 0;
+                for (int j = 0; i + j < limbs; ++j) {
+                    carry += (unsigned long long)arr[i] * b.arr[j] + r.arr[i+j];
+                    r.arr[i+j] = (l_type)carry;
+                    carry >>= 32;
+                }
+            }
+            return *this = r;
+        }
+        constexpr FixedBigInt& operator/=(const FixedBigInt& b) {
+            FixedBigInt q, r;
+            divmod(*this, b, q, r);
+            return *this = q;
+        }
+        constexpr FixedBigInt& operator%=(const FixedBigInt& b) {
+            FixedBigInt q, r;
+            divmod(*this, b, q, r);
+            return *this = r;
+        }
+        constexpr FixedBigInt& operator<<=(unsigned int n) {
+            if (n >= Bits)
+                return *this = FixedBigInt();
+            int w = n / 32, s = n % 32;
+            for (int i = limbs-1; i >= 0; --i) {
+                l_type hi = (i-w >= 0)? arr[i-w] : 0, lo = (i-w-1 >= 0)? arr[i-w-1] : 0;
+                arr[i] = s? (hi << s) | (lo >> (32-s)) : hi;
+            }
+            return *this;
+        }
+        //arithmetic shift: rounds toward negative infinity for negative values
+        constexpr FixedBigInt& operator>>=(unsigned int n) {
+            l_type fill = negative()? 0xFFFFFFFF : 0;
+            if (n >= Bits) {
+                for (int i = 0; i < limbs; ++i) arr[i] = fill;
+                return *this;
+            }
+            int w = n / 32, s = n % 32;
+            for (int i = 0; i < limbs; ++i) {
+                l_type lo = (i+w < limbs)? arr[i+w] : fill, hi = (i+w+1 < limbs)? arr[i+w+1] : fill;
+                arr[i] = s? (lo >> s) | (hi << (32-s)) : lo;
+            }
+            return *this;
+        }
+        constexpr FixedBigInt operator-() const {
+            FixedBigInt r = *this;
+            r.negateInPlace();
+            return r;
+        }
+        constexpr FixedBigInt& negate() {
+            negateInPlace();
+            return *this;
+        }
+        constexpr FixedBigInt& operator++() {return *this += FixedBigInt(1);}
+        constexpr FixedBigInt& operator--() {return *this -= FixedBigInt(1);}
+        constexpr FixedBigInt operator++(int) {FixedBigInt temp = *this; ++*this; return temp;}
+        constexpr FixedBigInt operator--(int) {FixedBigInt temp = *this; --*this; return temp;}
+
+        friend constexpr FixedBigInt operator+(FixedBigInt a, const FixedBigInt& b) {return a += b;}
+        friend constexpr FixedBigInt operator-(FixedBigInt a, const FixedBigInt& b) {return a -= b;}
+        friend constexpr FixedBigInt operator*(FixedBigInt a, const FixedBigInt& b) {return a *= b;}
+        friend constexpr FixedBigInt operator/(FixedBigInt a, const FixedBigInt& b) {return a /= b;}
+        friend constexpr FixedBigInt operator%(FixedBigInt a, const FixedBigInt& b) {return a %= b;}
+        friend constexpr FixedBigInt operator<<(FixedBigInt a, unsigned int n) {return a <<= n;}
+        friend constexpr FixedBigInt operator>>(FixedBigInt a, unsigned int n) {return a >>= n;}
+
+        friend constexpr bool operator<(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) < 0;}
+        friend constexpr bool operator<=(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) <= 0;}
+        friend constexpr bool operator>(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) > 0;}
+        friend constexpr bool operator>=(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) >= 0;}
+        friend constexpr bool operator==(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) == 0;}
+        friend constexpr bool operator!=(const FixedBigInt& lhs, const FixedBigInt& rhs) {return lhs.compare(rhs) != 0;}
+
+        friend constexpr FixedBigInt abs(const FixedBigInt& b) {return b.negative()? -b : b;}
+        friend std::string to_string(const FixedBigInt& b) {return to_string((BigInt)b);}
+        friend std::ostream& operator<<(std::ostream& os, const FixedBigInt& b) {return os << (BigInt)b;}
+    };
+    #endif
+}
+
+namespace std {
+    template<> struct hash<my::BigInt> {
+        size_t operator()(const my::BigInt& b) const {return b.hash();}
+    };
+    template<> struct hash<my::HashedBigInt> {
+        size_t operator()(const my::HashedBigInt& b) const {return b.hash();}
+    };
+    template<> struct hash<my::SharedBigInt> {
+        size_t operator()(const my::SharedBigInt& b) const {return b.hash();}
+    };
 }
 #endif